@@ -34,6 +34,7 @@ data class ModelConfig(
     @SerializedName("assistant_prompt_template")var assistantPromptTemplate:String?,
     @SerializedName("thinking_mode")var thinkingMode: Boolean?,
     @SerializedName("mmap")var mmap: Boolean?,
+    @SerializedName("embedding_persistent_cache")var embeddingPersistentCache: Boolean? = null,
     ) {
     fun deepCopy(): ModelConfig {
         return ModelConfig(
@@ -58,7 +59,8 @@ data class ModelConfig(
             maxNewTokens = this.maxNewTokens,
             assistantPromptTemplate = this.assistantPromptTemplate,
             thinkingMode = this.thinkingMode,
-            mmap = this.mmap
+            mmap = this.mmap,
+            embeddingPersistentCache = this.embeddingPersistentCache
         )
     }
 
@@ -8,14 +8,26 @@
 #include "include/asr/asr.hpp"
 #include "include/asr/asrconfig.hpp"
 #include "include/asr/tokenizer.hpp"
+#include "include/trace/mls_trace.hpp"
+#include "thread_pool.h"
+#include "vector_simd.h"
+
+#include <MNN/expr/ExecutorScope.hpp>
 
 #include <audio/audio.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <complex>
 #include <random>
 
 using namespace MNN::Express;
+using mls::simd::AddMulF32;
+using mls::simd::AxpyF32;
+using mls::simd::ScaleF32;
 namespace MNN {
     namespace Transformer {
 
@@ -116,16 +128,52 @@ namespace MNN {
             }
         }
 
+        // Streaming frontend state: samples that don't fill a whole fbank frame yet, and fbank
+        // frames not yet consumed by an LFR window (the left padding is added up front).
+        struct FrontendCache {
+            std::vector<float> waveform;
+            std::vector<float> frames;
+            int frame_count = 0;
+            int lfr_count = 0;
+            bool started = false;
+            // reused LFR + CMVN output
+            std::vector<float> output;
+        };
+
+        // Hotwords as paths of token ids, node 0 is the root. A stream tracks the nodes its
+        // latest tokens have reached and boosts the tokens that extend any of them.
+        struct HotwordTrie {
+            struct Node {
+                std::unordered_map<int, int> children;
+            };
+            std::vector<Node> nodes{1};
+            float score = 0.f;
+        };
+
         struct OnlineCache {
             int start_idx = 0;
             bool is_final = false;
             bool last_chunk = false;
             std::vector<int> chunk_size;
-            VARP cif_hidden;
-            VARP cif_alphas;
+            // partial CIF frame carried into the next chunk, and its accumulated weight
+            std::vector<float> cif_hidden;
+            float cif_alpha = 0.f;
             VARP feats;
             std::vector<VARP> decoder_fsmn;
             std::vector<int> tokens;
+            FrontendCache frontend;
+            // LFR frame index (from the start of the stream) of cache.feats[0] and of the
+            // window passed to the last infer(); the initial zero frames are negative
+            int64_t feats_start = 0;
+            int64_t window_start = 0;
+            // first frame of the token CIF is still integrating, -1 if none
+            int64_t cif_start = -1;
+            // [start, end) frames of the tokens fired by the last cif_search
+            std::vector<std::pair<int64_t, int64_t>> fires;
+            // tokens decoded since the owner last took them
+            std::vector<AsrToken> emitted;
+            std::shared_ptr<const HotwordTrie> hotwords;
+            std::vector<int> hotword_nodes;
         };
 
         class WavFrontend {
@@ -133,12 +181,18 @@ namespace MNN {
             WavFrontend(std::shared_ptr<AsrConfig> config) : config_(config) {
                 mean_ = config->mean();
                 var_ = config->var();
+                // fold the encoder input scale into CMVN: ((x + mean) * var) * scale
+                float scale = std::sqrt(static_cast<float>(config->encoder_output_size()));
+                for (auto& v : var_) {
+                    v *= scale;
+                }
             }
             ~WavFrontend() = default;
-            VARP apply_lfr(VARP samples);
-            VARP apply_cmvn(VARP samples);
-            VARP extract_feat(VARP samples);
+            // Consumes new samples and returns the LFR + CMVN features [1, n, 560] they complete,
+            // or nullptr when none are complete yet. is_final flushes the buffered frames.
+            VARP extract_feat(FrontendCache& cache, const float* samples, size_t size, bool is_final);
         private:
+            int apply_lfr_cmvn(FrontendCache& cache, bool is_final);
             std::shared_ptr<AsrConfig> config_;
             std::vector<float> mean_;
             std::vector<float> var_;
@@ -153,65 +207,131 @@ namespace MNN {
             int feats_dims_ = 560;
         };
 
-        VARP WavFrontend::apply_cmvn(VARP samples) {
-            auto mean = _Const(mean_.data(), {static_cast<int>(mean_.size())});
-            auto var  = _Const(var_.data(), {static_cast<int>(mean_.size())});
-            samples = (samples + mean) * var;
-            return samples;
+        // Stacks lfr_m_ frames every lfr_n_ frames and normalizes them in the same pass.
+        int WavFrontend::apply_lfr_cmvn(FrontendCache& cache, bool is_final) {
+            int buffered = static_cast<int>(cache.frames.size()) / num_bins_;
+            if (buffered == 0) {
+                return 0;
+            }
+            // window k starts at buffer row k * lfr_n_; the last real frame is padded on the right
+            // once the utterance ends, like the offline frontend does
+            int count = 0;
+            if (is_final) {
+                count = DIV_UP(cache.frame_count, lfr_n_) - cache.lfr_count;
+            } else if (buffered >= lfr_m_) {
+                count = (buffered - lfr_m_) / lfr_n_ + 1;
+            }
+            count = std::max(count, 0);
+            cache.output.resize(static_cast<size_t>(count) * feats_dims_);
+            const float* last_frame = cache.frames.data() + (buffered - 1) * num_bins_;
+            for (int k = 0; k < count; k++) {
+                float* out = cache.output.data() + k * feats_dims_;
+                for (int j = 0; j < lfr_m_; j++) {
+                    int row = k * lfr_n_ + j;
+                    const float* frame = row < buffered ? cache.frames.data() + row * num_bins_ : last_frame;
+                    AddMulF32(frame, mean_.data() + j * num_bins_, var_.data() + j * num_bins_, out + j * num_bins_, num_bins_);
+                }
+            }
+            cache.lfr_count += count;
+            int consumed = std::min(count * lfr_n_, buffered);
+            cache.frames.erase(cache.frames.begin(), cache.frames.begin() + consumed * num_bins_);
+            return count;
         }
 
-        VARP WavFrontend::apply_lfr(VARP samples) {
-            auto dim = samples->getInfo()->dim;
-            int row = dim[0];
-            int padding_len = (lfr_m_ - 1) / 2;
-            int t_lfr = DIV_UP(row, lfr_n_);
-            std::vector<int> lfr_regions = {
-                    // region 0
-                    0,                               // src offset
-                    1, 0, 1,                         // src strides
-                    0,                               // dst offset
-                    1, num_bins_, 1,                 // dst strides
-                    1, padding_len, num_bins_,       // dst sizes
-                    // region 1
-                    0,                                  // src offset
-                    1, num_bins_, 1,                    // src strides
-                    padding_len * num_bins_,            // dst offset
-                    1, num_bins_, 1,                    // dst strides
-                    1, lfr_m_ - padding_len, num_bins_, // dst sizes
-                    // region 2
-                    (lfr_n_ - padding_len) * num_bins_, // src offset
-                    lfr_n_ * num_bins_, num_bins_, 1,   // src strides
-                    lfr_m_ * num_bins_,                 // dst offset
-                    lfr_m_ * num_bins_, num_bins_, 1,   // dst strides
-                    t_lfr, lfr_m_, num_bins_            // dst sizes
-            };
-            samples = _Raster({samples, samples, samples}, lfr_regions, {1, t_lfr, lfr_m_ * num_bins_});
-            return samples;
+        VARP WavFrontend::extract_feat(FrontendCache& cache, const float* samples, size_t size, bool is_final) {
+            MLS_TRACE_SCOPE("asr", "fbank");
+            int frame_length = sampling_rate / 1000 * frame_length_ms_;
+            int frame_shift = sampling_rate / 1000 * frame_shift_ms_;
+            // fbank works on int16-range samples; scale while appending to the carried remainder
+            size_t carried = cache.waveform.size();
+            cache.waveform.resize(carried + size);
+            ScaleF32(32768.f, samples, cache.waveform.data() + carried, size);
+            int total = static_cast<int>(cache.waveform.size());
+            int frame_num = total >= frame_length ? (total - frame_length) / frame_shift + 1 : 0;
+            if (frame_num > 0) {
+                int used = (frame_num - 1) * frame_shift + frame_length;
+                auto waveform = _Const(cache.waveform.data(), {used}, NHWC, halide_type_of<float>());
+                auto fbank = AUDIO::fbank(waveform);
+                int rows = std::min(fbank->getInfo()->dim[0], frame_num);
+                auto fbank_ptr = fbank->readMap<float>();
+                if (!cache.started) {
+                    // left padding: (lfr_m - 1) / 2 copies of the first frame
+                    for (int i = 0; i < (lfr_m_ - 1) / 2; i++) {
+                        cache.frames.insert(cache.frames.end(), fbank_ptr, fbank_ptr + num_bins_);
+                    }
+                    cache.started = true;
+                }
+                cache.frames.insert(cache.frames.end(), fbank_ptr, fbank_ptr + rows * num_bins_);
+                cache.frame_count += rows;
+                // keep what the next frame still needs: everything after the consumed shifts
+                cache.waveform.erase(cache.waveform.begin(), cache.waveform.begin() + rows * frame_shift);
+            }
+            int count = apply_lfr_cmvn(cache, is_final);
+            if (is_final) {
+                cache.waveform.clear();
+            }
+            if (count == 0) {
+                return nullptr;
+            }
+            return _Const(cache.output.data(), {1, count, feats_dims_}, NCHW, halide_type_of<float>());
+        }
+
+        // Sinusoid for absolute position `position`, sin in the first half of the row, cos in the second.
+        static void SinusoidRow(int position, float* row, int feat_dims) {
+            constexpr float neglog_timescale = -0.03301197265941284;
+            int half = feat_dims / 2;
+            for (int j = 0; j < half; j++) {
+                float inv_timescale = position * std::exp(j * neglog_timescale);
+                row[j]        = std::sin(inv_timescale);
+                row[j + half] = std::cos(inv_timescale);
+            }
         }
 
-        VARP WavFrontend::extract_feat(VARP waveforms) {
-            waveforms = waveforms * _Scalar<float>(32768);
-            auto feature = AUDIO::fbank(waveforms);
-            feature = apply_lfr(feature);
-            feature = apply_cmvn(feature);
-            return feature;
+        // Rows of the sinusoid table for absolute positions [begin, begin + length), cut short at
+        // POSITION_BLOCK * POSITION_MAX_BLOCKS; later positions are computed by the caller. The
+        // table grows in fixed blocks that never move, so returned rows stay valid for other streams.
+        std::vector<const float*> Asr::position_rows(int begin, int length, int feat_dims) {
+            std::lock_guard<std::mutex> lock(position_mutex_);
+            if (position_dims_ != feat_dims) {
+                position_blocks_.clear();
+                position_dims_ = feat_dims;
+            }
+            int end = std::min(begin + length, POSITION_BLOCK * POSITION_MAX_BLOCKS);
+            while (static_cast<int>(position_blocks_.size()) * POSITION_BLOCK < end) {
+                int base = static_cast<int>(position_blocks_.size()) * POSITION_BLOCK;
+                std::unique_ptr<float[]> block(new float[POSITION_BLOCK * feat_dims]);
+                for (int p = 0; p < POSITION_BLOCK; p++) {
+                    SinusoidRow(base + p, block.get() + p * feat_dims, feat_dims);
+                }
+                position_blocks_.push_back(std::move(block));
+            }
+            std::vector<const float*> rows(std::max(0, end - begin));
+            for (int i = 0; i < static_cast<int>(rows.size()); i++) {
+                int position = begin + i;
+                rows[i] = position_blocks_[position / POSITION_BLOCK].get() + (position % POSITION_BLOCK) * feat_dims;
+            }
+            return rows;
         }
 
-        VARP Asr::position_encoding(VARP samples) {
+        VARP Asr::position_encoding(OnlineCache& cache, VARP samples) {
+            MLS_TRACE_SCOPE("asr", "position_encoding");
             auto ptr = (float*)samples->readMap<float>();
             auto dims = samples->getInfo()->dim;
             int length = dims[1];
             int feat_dims = dims[2];
-            constexpr float neglog_timescale = -0.03301197265941284;
-            for (int i = 0; i < length; i++) {
-                int offset = i + 1 + cache_->start_idx;
-                for (int j = 0; j < feat_dims / 2; j++) {
-                    float inv_timescale = offset * std::exp(j * neglog_timescale);
-                    ptr[i * feat_dims + j]                 += std::sin(inv_timescale);
-                    ptr[i * feat_dims + j + feat_dims / 2] += std::cos(inv_timescale);
-                }
+            // positions are 1-based
+            auto rows = position_rows(cache.start_idx + 1, length, feat_dims);
+            int cached = static_cast<int>(rows.size());
+            for (int i = 0; i < cached; i++) {
+                AxpyF32(1.f, rows[i], ptr + i * feat_dims, feat_dims);
+            }
+            // streams longer than the table pay the sin/cos per frame
+            std::vector<float> row(cached < length ? feat_dims : 0, 0.f);
+            for (int i = cached; i < length; i++) {
+                SinusoidRow(cache.start_idx + 1 + i, row.data(), feat_dims);
+                AxpyF32(1.f, row.data(), ptr + i * feat_dims, feat_dims);
             }
-            cache_->start_idx += length;
+            cache.start_idx += length;
             return samples;
         }
 
@@ -224,175 +344,432 @@ namespace MNN {
             return _Const(data.data(), dims, NCHW, halide_type_of<float>());
         }
 
-        void Asr::init_cache(int batch_size) {
-            cache_.reset(new OnlineCache);
-            cache_->start_idx = 0;
-            cache_->is_final = false;
-            cache_->last_chunk = false;
-            cache_->chunk_size = chunk_size_;
-            cache_->cif_hidden = _zeros({batch_size, 1, config_->encoder_output_size()});
-            cache_->cif_alphas = _zeros({batch_size, 1});
-            cache_->feats = _zeros({batch_size, chunk_size_[0] + chunk_size_[2], feats_dims_});
+        std::shared_ptr<OnlineCache> Asr::init_cache(int batch_size) {
+            std::shared_ptr<OnlineCache> cache(new OnlineCache);
+            cache->start_idx = 0;
+            cache->is_final = false;
+            cache->last_chunk = false;
+            cache->chunk_size = chunk_size_;
+            cache->cif_hidden.assign(config_->encoder_output_size(), 0.f);
+            cache->cif_alpha = 0.f;
+            cache->feats = _zeros({batch_size, chunk_size_[0] + chunk_size_[2], feats_dims_});
+            cache->feats_start = -(chunk_size_[0] + chunk_size_[2]);
+            cache->window_start = cache->feats_start;
+            cache->cif_start = -1;
+            cache->hotword_nodes.assign(1, 0);
             for (int i = 0; i < config_->fsmn_layer(); i++) {
-                cache_->decoder_fsmn.emplace_back(_zeros({batch_size, config_->fsmn_dims(), config_->fsmn_lorder()}));
+                cache->decoder_fsmn.emplace_back(_zeros({batch_size, config_->fsmn_dims(), config_->fsmn_lorder()}));
             }
+            return cache;
         }
 
-        VARP Asr::add_overlap_chunk(VARP feats) {
-            if (!cache_) return feats;
-            feats = _Concat({cache_->feats, feats}, 1);
-            if (cache_->is_final) {
-                cache_->feats = _Slice(feats, _var<int>({0, -chunk_size_[0], 0}, {3}), _var<int>({-1, -1, -1}, {3}));
-                if (!cache_->last_chunk) {
-                    int padding_length = std::accumulate(chunk_size_.begin(), chunk_size_.end(), 0) - feats->getInfo()->dim[1];
+        VARP Asr::add_overlap_chunk(OnlineCache& cache, VARP feats) {
+            feats = _Concat({cache.feats, feats}, 1);
+            int window_length = feats->getInfo()->dim[1];
+            int keep = cache.is_final ? chunk_size_[0] : chunk_size_[0] + chunk_size_[2];
+            cache.window_start = cache.feats_start;
+            cache.feats_start = cache.window_start + window_length - keep;
+            if (cache.is_final) {
+                cache.feats = _Slice(feats, _var<int>({0, -chunk_size_[0], 0}, {3}), _var<int>({-1, -1, -1}, {3}));
+                if (!cache.last_chunk) {
+                    int padding_length = std::accumulate(chunk_size_.begin(), chunk_size_.end(), 0) - window_length;
                     feats = _Pad(feats, _var<int>({0, 0, 0, padding_length, 0, 0}, {3, 2}));
                 }
             } else {
-                cache_->feats = _Slice(feats, _var<int>({0, -(chunk_size_[0] + chunk_size_[2]), 0}, {3}), _var<int>({-1, -1, -1}, {3}));
+                cache.feats = _Slice(feats, _var<int>({0, -(chunk_size_[0] + chunk_size_[2]), 0}, {3}), _var<int>({-1, -1, -1}, {3}));
             }
             return feats;
         }
 
-        VARPS Asr::cif_search(VARP hidden, VARP alphas) {
-            auto chunk_alpha_ptr = const_cast<float*>(alphas->readMap<float>());
-            for (int i = 0; i < alphas->getInfo()->size; i++) {
-                if (i < chunk_size_[0] || i >= chunk_size_[0] + chunk_size_[1]) {
-                    chunk_alpha_ptr[i] = 0.f;
-                }
-            }
-            if (cache_->last_chunk) {
-                int hidden_size = hidden->getInfo()->dim[2];
-                auto tail_hidden = _zeros({1, 1, hidden_size});
-                auto tail_alphas = _var<float>({config_->tail_threshold()}, {1, 1});
-                hidden = _Concat({cache_->cif_hidden, hidden, tail_hidden}, 1);
-                alphas = _Concat({cache_->cif_alphas, alphas, tail_alphas}, 1);
-            } else {
-                hidden = _Concat({cache_->cif_hidden, hidden}, 1);
-                alphas = _Concat({cache_->cif_alphas, alphas}, 1);
-            }
-            auto alpha_ptr = alphas->readMap<float>();
-
+        // Continuous integrate-and-fire over the raw encoder buffers. The steps are the carried
+        // partial frame, the encoder frames (only those of the current chunk have weight) and,
+        // on the last chunk, a zero tail frame that flushes the remainder.
+        int Asr::cif_search(OnlineCache& cache, VARP hidden, VARP alphas, VARP& acoustic_embeds) {
             auto dims = hidden->getInfo()->dim;
-            int batch_size = dims[0], len_time = dims[1], hidden_size = dims[2];
-            auto frames = _zeros({hidden_size});
+            int len_time = dims[1], hidden_size = dims[2];
+            auto hidden_ptr = hidden->readMap<float>();
+            auto alpha_ptr = alphas->readMap<float>();
+            int chunk_begin = chunk_size_[0];
+            int chunk_end = chunk_size_[0] + chunk_size_[1];
             float cif_threshold = config_->cif_threshold();
+            std::vector<float> tail_hidden;
+            if (cache.last_chunk) {
+                tail_hidden.assign(hidden_size, 0.f);
+            }
+            int steps = len_time + 1 + (cache.last_chunk ? 1 : 0);
+            auto step_alpha = [&](int s) {
+                if (s == 0) {
+                    return cache.cif_alpha;
+                }
+                int t = s - 1;
+                if (t == len_time) {
+                    return config_->tail_threshold();
+                }
+                return t >= chunk_begin && t < chunk_end ? alpha_ptr[t] : 0.f;
+            };
+            auto step_hidden = [&](int s) {
+                if (s == 0) {
+                    return static_cast<const float*>(cache.cif_hidden.data());
+                }
+                return s - 1 == len_time ? tail_hidden.data() : hidden_ptr + (s - 1) * hidden_size;
+            };
+            // pass 1 on the weights alone sizes the output; pass 2 repeats the exact same
+            // arithmetic, so both make the same fire decisions
+            int fire_count = 0;
             float integrate = 0.f;
-            std::vector<VARP> list_frame;
-            for (int t = 0; t < len_time; t++) {
-                float alpha = alpha_ptr[t];
-                auto hidden_t = _GatherV2(hidden, _var<int>({t}, {1}), _Scalar<int>(1));
+            for (int s = 0; s < steps; s++) {
+                float alpha = step_alpha(s);
                 if (alpha + integrate < cif_threshold) {
                     integrate += alpha;
-                    frames = frames + _Scalar<float>(alpha) * hidden_t;
                 } else {
-                    frames = frames + _Scalar<float>(cif_threshold - integrate) * hidden_t;
-                    list_frame.push_back(frames);
+                    fire_count++;
                     integrate += alpha;
                     integrate -= cif_threshold;
-                    frames = _Scalar<float>(integrate) * hidden_t;
                 }
             }
-            // update cache
-            cache_->cif_alphas = _var<float>({integrate}, {1, 1});
-            cache_->cif_hidden = integrate > 0.f ? (frames / _Scalar<float>(integrate)) : frames;
-            return list_frame;
+            float* output = nullptr;
+            if (fire_count > 0) {
+                acoustic_embeds = _Input({1, fire_count, hidden_size}, NCHW, halide_type_of<float>());
+                output = acoustic_embeds->writeMap<float>();
+                ::memset(output, 0, fire_count * hidden_size * sizeof(float));
+            }
+            std::vector<float> remainder(hidden_size, 0.f);
+            int fired = 0;
+            float* frame = fire_count > 0 ? output : remainder.data();
+            integrate = 0.f;
+            // frame of each step for timestamps; the zero tail belongs to the last real frame
+            auto step_frame = [&](int s) {
+                return cache.window_start + std::min(s - 1, len_time - 1);
+            };
+            cache.fires.clear();
+            int64_t token_start = cache.cif_start;
+            for (int s = 0; s < steps; s++) {
+                float alpha = step_alpha(s);
+                const float* hidden_t = step_hidden(s);
+                if (s > 0 && alpha > 0.f && token_start < 0) {
+                    token_start = step_frame(s);
+                }
+                if (alpha + integrate < cif_threshold) {
+                    integrate += alpha;
+                    if (alpha != 0.f) {
+                        AxpyF32(alpha, hidden_t, frame, hidden_size);
+                    }
+                } else {
+                    AxpyF32(cif_threshold - integrate, hidden_t, frame, hidden_size);
+                    fired++;
+                    frame = fired < fire_count ? output + fired * hidden_size : remainder.data();
+                    integrate += alpha;
+                    integrate -= cif_threshold;
+                    ScaleF32(integrate, hidden_t, frame, hidden_size);
+                    int64_t fire_frame = s > 0 ? step_frame(s) : std::max<int64_t>(token_start, 0);
+                    int64_t start_frame = std::max<int64_t>(std::min(token_start, fire_frame), 0);
+                    cache.fires.emplace_back(start_frame, std::max(fire_frame + 1, start_frame + 1));
+                    // the rest of this frame's weight starts the next token
+                    token_start = integrate > 0.f ? fire_frame : -1;
+                }
+            }
+            cache.cif_start = token_start;
+            // carry the partial frame, normalized, into the next chunk
+            cache.cif_alpha = integrate;
+            cache.cif_hidden.resize(hidden_size);
+            ScaleF32(integrate > 0.f ? 1.f / integrate : 1.f, remainder.data(), cache.cif_hidden.data(), hidden_size);
+            return fire_count;
         }
 
-
-
-        std::string Asr::decode(MNN::Express::VARP logits) {
-            int token_num = logits->getInfo()->dim[1];
-            auto token_ptr = _ArgMax(logits, -1)->readMap<int>();
+        // Greedy pick per fired frame. The argmax and its softmax probability come from one
+        // pass over the logits row.
+        std::string Asr::decode(OnlineCache& cache, MNN::Express::VARP logits) {
+            auto dims = logits->getInfo()->dim;
+            int token_num = dims[1];
+            int vocab_size = dims[2];
+            auto logits_ptr = logits->readMap<float>();
+            float frame_seconds = config_->lfr_n() * config_->frame_shift_ms() / 1000.f;
             std::string text;
+            const HotwordTrie* hotwords = cache.hotwords.get();
             for (int i = 0; i < token_num; i++) {
-                int token = token_ptr[i];
+                const float* row = logits_ptr + i * vocab_size;
+                int token = static_cast<int>(std::max_element(row, row + vocab_size) - row);
+                if (hotwords != nullptr) {
+                    // logit bias only on tokens that continue a hotword the decoder has already
+                    // started on its own; the root (node 0) is tracked to start matches but never
+                    // biased, so hotword heads are not forced in at every step
+                    float best = row[token];
+                    for (int node : cache.hotword_nodes) {
+                        if (node == 0) {
+                            continue;
+                        }
+                        for (const auto& child : hotwords->nodes[node].children) {
+                            if (child.first < vocab_size && row[child.first] + hotwords->score > best) {
+                                best = row[child.first] + hotwords->score;
+                                token = child.first;
+                            }
+                        }
+                    }
+                }
                 if (tokenizer_->is_special(token)) {
                     continue;
                 }
-                cache_->tokens.push_back(token);
+                if (hotwords != nullptr) {
+                    std::vector<int> next_nodes(1, 0);
+                    for (int node : cache.hotword_nodes) {
+                        auto it = hotwords->nodes[node].children.find(token);
+                        if (it != hotwords->nodes[node].children.end()) {
+                            next_nodes.push_back(it->second);
+                        }
+                    }
+                    cache.hotword_nodes.swap(next_nodes);
+                }
+                float max_logit = row[token];
+                float sum = 0.f;
+                for (int v = 0; v < vocab_size; v++) {
+                    sum += std::exp(row[v] - max_logit);
+                }
+                cache.tokens.push_back(token);
                 auto symbol = tokenizer_->decode(token);
+                AsrToken item;
+                item.confidence = 1.f / sum;
+                if (i < static_cast<int>(cache.fires.size())) {
+                    item.start = cache.fires[i].first * frame_seconds;
+                    item.end = cache.fires[i].second * frame_seconds;
+                }
                 // end with '@@'
                 if (symbol.size() > 2 && symbol.back() == '@' && symbol[symbol.size() - 2] == '@') {
                     symbol = std::string(symbol.data(), symbol.size() - 2);
+                    item.text = symbol;
                 } else {
+                    item.text = symbol;
                     if (reinterpret_cast<const uint8_t *>(symbol.c_str())[0] < 0x80) {
                         symbol.append(" ");
                     }
                 }
+                cache.emitted.push_back(std::move(item));
                 text.append(symbol);
             }
             return text;
         }
 
-        std::string Asr::infer(VARP feats) {
-            auto enc_len = _Input({1}, NCHW, halide_type_of<int>());
-            enc_len->writeMap<int>()[0] = feats->getInfo()->dim[1];
-            auto encoder_outputs = modules_[0]->onForward({feats, enc_len});
+        // Flat combining: the first caller to find the encoder idle runs every request queued
+        // so far, batched by length, then hands the results back; the others just wait.
+        VARPS Asr::encode(VARP feats) {
+            EncoderRequest request;
+            request.feats = feats;
+            std::unique_lock<std::mutex> lock(encoder_mutex_);
+            encoder_queue_.push_back(&request);
+            while (!request.done) {
+                if (encoder_busy_) {
+                    encoder_cv_.wait(lock);
+                    continue;
+                }
+                encoder_busy_ = true;
+                std::vector<EncoderRequest*> batch;
+                batch.swap(encoder_queue_);
+                lock.unlock();
+                run_encoder_batch(batch);
+                lock.lock();
+                for (auto item : batch) {
+                    item->done = true;
+                }
+                encoder_busy_ = false;
+                encoder_cv_.notify_all();
+            }
+            return request.outputs;
+        }
+
+        void Asr::run_encoder_batch(std::vector<EncoderRequest*>& requests) {
+            std::unordered_map<int, std::vector<EncoderRequest*>> groups;
+            for (auto request : requests) {
+                groups[request->feats->getInfo()->dim[1]].push_back(request);
+            }
+            for (auto& group : groups) {
+                int length = group.first;
+                auto& items = group.second;
+                int batch = static_cast<int>(items.size());
+                MLS_TRACE_SCOPE("asr", "encoder");
+                VARPS feats_list;
+                for (auto item : items) {
+                    feats_list.push_back(item->feats);
+                }
+                auto feats = batch == 1 ? feats_list[0] : _Concat(feats_list, 0);
+                auto enc_len = _Input({batch}, NCHW, halide_type_of<int>());
+                auto enc_len_ptr = enc_len->writeMap<int>();
+                for (int b = 0; b < batch; b++) {
+                    enc_len_ptr[b] = length;
+                }
+                auto outputs = modules_[0]->onForward({feats, enc_len});
+                if (batch == 1) {
+                    for (auto& output : outputs) {
+                        output.fix(VARP::CONSTANT);
+                    }
+                    items[0]->outputs = outputs;
+                    continue;
+                }
+                // copy every row out, so the waiting streams don't share lazily computed
+                // expressions with this thread
+                for (auto& output : outputs) {
+                    auto info = output->getInfo();
+                    auto dims = info->dim;
+                    dims[0] = 1;
+                    size_t row = info->size / batch;
+                    for (int b = 0; b < batch; b++) {
+                        VARP part;
+                        if (info->type == halide_type_of<int>()) {
+                            part = _Const(output->readMap<int>() + b * row, dims, info->order, halide_type_of<int>());
+                        } else {
+                            part = _Const(output->readMap<float>() + b * row, dims, info->order, halide_type_of<float>());
+                        }
+                        items[b]->outputs.push_back(part);
+                    }
+                }
+            }
+        }
+
+        std::string Asr::infer(OnlineCache& cache, VARP feats) {
+            // computed here on the stream's own executor, not by whichever thread runs the batch
+            feats.fix(VARP::CONSTANT);
+            auto encoder_outputs = encode(feats);
             auto alphas = encoder_outputs[0];
             auto enc = encoder_outputs[1];
-            enc_len = encoder_outputs[2];
-            auto acoustic_embeds_list = cif_search(enc, alphas);
-            if (acoustic_embeds_list.empty()) {
+            auto enc_len = encoder_outputs[2];
+            VARP acoustic_embeds;
+            int acoustic_embeds_len = 0;
+            {
+                MLS_TRACE_SCOPE("asr", "cif");
+                acoustic_embeds_len = cif_search(cache, enc, alphas, acoustic_embeds);
+            }
+            if (acoustic_embeds_len == 0) {
                 return "";
             }
-            auto acoustic_embeds = _Concat(acoustic_embeds_list, 1);
-            int acoustic_embeds_len = static_cast<int>(acoustic_embeds_list.size());
             VARPS decocder_inputs {enc, enc_len, acoustic_embeds, _var<int>({acoustic_embeds_len}, {1})};
-            for (auto fsmn : cache_->decoder_fsmn) {
+            for (auto fsmn : cache.decoder_fsmn) {
                 decocder_inputs.push_back(fsmn);
             }
-            auto decoder_outputs = modules_[1]->onForward(decocder_inputs);
+            VARPS decoder_outputs;
+            {
+                MLS_TRACE_SCOPE("asr", "decoder");
+                std::lock_guard<std::mutex> lock(decoder_mutex_);
+                decoder_outputs = modules_[1]->onForward(decocder_inputs);
+                // materialize before another stream reuses the decoder
+                for (auto& output : decoder_outputs) {
+                    output.fix(VARP::CONSTANT);
+                }
+            }
 
             auto logits = decoder_outputs[0];
             for (int i = 0; i < config_->fsmn_layer(); i++) {
-                cache_->decoder_fsmn[i] = decoder_outputs[2 + i];
+                cache.decoder_fsmn[i] = decoder_outputs[2 + i];
             }
-            auto text = decode(logits);
+            auto text = decode(cache, logits);
             // printf("%s", text.c_str());
             return text;
         }
 
         // std::string Asr::recognize(std::vector<float>& waveforms) {
-        std::string Asr::recognize(VARP waveforms) {
-            size_t wave_length = waveforms->getInfo()->size;
-            if (wave_length < 16 * 60 && cache_->is_final) {
-                cache_->last_chunk = true;
-                return infer(cache_->feats);
-            }
-            // auto t1 = std::chrono::system_clock::now();
-            auto feats = frontend_->extract_feat(waveforms);
-            // std::cout << "feats time: " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - t1).count() << std::endl;
-
-            feats = feats * _Scalar<float>(std::sqrt(config_->encoder_output_size()));
-            feats = position_encoding(feats);
-            if (cache_->is_final) {
+        std::string Asr::recognize(OnlineCache& cache, const float* samples, size_t size) {
+            auto feats = frontend_->extract_feat(cache.frontend, samples, size, cache.is_final);
+            if (feats.get() == nullptr) {
+                if (!cache.is_final) {
+                    return "";
+                }
+                // nothing new: flush the cached overlap frames
+                cache.last_chunk = true;
+                cache.window_start = cache.feats_start;
+                return infer(cache, cache.feats);
+            }
+            // the encoder input scale is already folded into the CMVN weights
+            feats = position_encoding(cache, feats);
+            if (cache.is_final) {
                 auto dims = feats->getInfo()->dim;
                 if (dims[1] + chunk_size_[2] <= chunk_size_[1]) {
-                    cache_->last_chunk = true;
-                    feats = add_overlap_chunk(feats);
+                    cache.last_chunk = true;
+                    feats = add_overlap_chunk(cache, feats);
                 } else {
                     // first chunk
                     auto feats1 = feats;
                     if (dims[1] > chunk_size_[1]) {
                         feats1 = _Slice(feats, _var<int>({0, 0, 0}, {3}), _var<int>({-1, chunk_size_[1], -1}, {3}));
                     }
-                    auto feats_chunk1 = add_overlap_chunk(feats1);
-                    auto res1 = infer(feats_chunk1);
+                    auto feats_chunk1 = add_overlap_chunk(cache, feats1);
+                    auto res1 = infer(cache, feats_chunk1);
                     // last chunk
-                    cache_->last_chunk = true;
+                    cache.last_chunk = true;
                     auto feat2 = feats;
                     int start = dims[1] + chunk_size_[2] - chunk_size_[1];
                     if (start != 0) {
                         feat2 = _Slice(feats, _var<int>({0, -start, 0}, {3}), _var<int>({-1, -1, -1}, {3}));
                     }
-                    auto feats_chunk2 = add_overlap_chunk(feat2);
-                    auto res2 = infer(feats_chunk2);
+                    auto feats_chunk2 = add_overlap_chunk(cache, feat2);
+                    auto res2 = infer(cache, feats_chunk2);
                     return res1 + res2;
                 }
             } else {
-                feats = add_overlap_chunk(feats);
+                feats = add_overlap_chunk(cache, feats);
             }
-            return infer(feats);
+            return infer(cache, feats);
+        }
+
+        std::string Asr::recognize(VARP speech) {
+            auto stream = create_stream(false);
+            stream->accept_waveform(speech->readMap<float>(), speech->getInfo()->size);
+            return stream->finalize();
+        }
+
+        std::string Asr::offline_recognize(const std::string &wav_file, std::vector<AsrSegment>* segments) {
+            auto begin = std::chrono::steady_clock::now();
+            auto audio_file = AUDIO::load(wav_file);
+            auto speech = audio_file.first;
+            int64_t speech_length = speech->getInfo()->size;
+            auto speech_ptr = speech->readMap<float>();
+
+            // split at VAD boundaries, each segment is recognized as an independent stream
+            std::vector<std::pair<int64_t, int64_t>> ranges;
+            if (config_->vad()) {
+                Vad vad(vad_options());
+                int64_t frame_samples = vad.frame_samples();
+                int64_t offset = 0;
+                for (; offset + frame_samples <= speech_length; offset += frame_samples) {
+                    if (vad.accept_frame(speech_ptr + offset) == Vad::Event::SPEECH_END) {
+                        ranges.emplace_back(vad.segment_start() * frame_samples, vad.segment_end() * frame_samples);
+                    }
+                }
+                if (vad.in_speech()) {
+                    ranges.emplace_back(vad.segment_start() * frame_samples, speech_length);
+                }
+            } else if (speech_length > 0) {
+                ranges.emplace_back(0, speech_length);
+            }
+
+            // segments run side by side: their encoder calls are combined into batches by
+            // encode(), the rest of each stream runs on its own pool thread
+            std::vector<std::string> texts(ranges.size());
+            std::vector<std::vector<AsrToken>> tokens(ranges.size());
+            mls::ThreadPool::Shared().ParallelFor(ranges.size(), [&](size_t i) {
+                auto stream = create_stream(false);
+                int64_t chunk_size = chunk_samples();
+                for (int64_t offset = ranges[i].first; offset < ranges[i].second; offset += chunk_size) {
+                    stream->accept_waveform(speech_ptr + offset, std::min(chunk_size, ranges[i].second - offset));
+                }
+                texts[i] = stream->finalize();
+                tokens[i] = stream->get_tokens();
+            });
+
+            std::string total;
+            float rate = static_cast<float>(config_->samp_freq());
+            for (size_t i = 0; i < ranges.size(); i++) {
+                total += texts[i];
+                if (segments) {
+                    float start = ranges[i].first / rate;
+                    for (auto& token : tokens[i]) {
+                        token.start += start;
+                        token.end += start;
+                    }
+                    segments->push_back({start, ranges[i].second / rate, texts[i], std::move(tokens[i])});
+                }
+            }
+            float wall = std::chrono::duration<float>(std::chrono::steady_clock::now() - begin).count();
+            float audio = speech_length / rate;
+            MNN_PRINT("offline asr: %zu segments, %.2f s audio in %.2f s, %.2f audio-sec/wall-sec\n",
+                      ranges.size(), audio, wall, wall > 0 ? audio / wall : 0.f);
+            return total;
         }
 
         void Asr::online_recognize(const std::string &wav_file) {
@@ -435,17 +812,15 @@ namespace MNN {
 #endif
             int chunk_size = chunk_size_[1] * 960;
             int steps = DIV_UP(speech_length, chunk_size);
-            init_cache();
+            auto cache = init_cache();
             std::string total = "";
             for (int i = 0; i < steps; i++) {
                 int deal_size = chunk_size;
                 if (i == steps - 1) {
-                    cache_->is_final = true;
+                    cache->is_final = true;
                     deal_size = speech_length - i * chunk_size;
                 }
-                // std::vector<float> chunk(speech.begin() + i * chunk_size, speech.begin() + i * chunk_size + deal_size);
-                auto chunk = _Slice(speech, _var<int>({i * chunk_size + start}, {1}), _var<int>({deal_size}, {1}));
-                auto res = recognize(chunk);
+                auto res = recognize(*cache, speech->readMap<float>() + i * chunk_size + start, deal_size);
                 std::cout << "preds: " << res << std::endl;
                 total += res;
                 // std::cout << res;
@@ -457,45 +832,291 @@ namespace MNN {
         void Asr::online_recognize_stream(
                 const std::string &wav_file,
                 std::function<void(const std::string &)> on_partial,
-                std::function<void(const std::string &)> on_final) {
+                std::function<void(const std::string &)> on_final,
+                std::function<void(const AsrSegment &)> on_segment) {
 
             auto audio_file = AUDIO::load(wav_file);
             auto speech = audio_file.first;
-            int sample_rate = audio_file.second;
-            auto speech_length = speech->getInfo()->size;
-            auto speech_ptr = speech->readMap<int>();
+            int speech_length = speech->getInfo()->size;
+            auto speech_ptr = speech->readMap<float>();
 
-            int start = 0;
-            int end = speech_length - 1;
-            while (start < speech_length && speech_ptr[start] == 0) start++;
-            while (end >= 0 && speech_ptr[end] == 0) end--;
-            speech_length = end - start + 1;
+            auto stream = create_stream();
+            auto emit = [&]() {
+                if (on_partial) {
+                    on_partial(stream->get_partial());
+                }
+                auto segments = stream->get_segments();
+                if (on_segment) {
+                    for (const auto& segment : segments) {
+                        on_segment(segment);
+                    }
+                }
+            };
+            int chunk_size = chunk_samples();
+            for (int offset = 0; offset < speech_length; offset += chunk_size) {
+                int deal_size = std::min(chunk_size, speech_length - offset);
+                stream->accept_waveform(speech_ptr + offset, deal_size);
+                emit();
+            }
+            auto total = stream->finalize();
+            emit();
+            if (on_final) {
+                on_final(total);
+            }
+        }
 
-            int chunk_size = chunk_size_[1] * 960;
-            int steps = DIV_UP(speech_length, chunk_size);
-            init_cache();
+        bool Asr::split_hotword(const std::string& word, std::vector<int>& ids) const {
+            size_t pos = 0;
+            while (pos < word.size()) {
+                int id = -1;
+                size_t length = word.size() - pos;
+                // longest piece first; inside a word "xx@@" pieces come first, at its end plain ones
+                for (; length > 0; length--) {
+                    auto piece = word.substr(pos, length);
+                    bool last = pos + length == word.size();
+                    const auto& primary = last ? word_pieces_ : prefix_pieces_;
+                    const auto& secondary = last ? prefix_pieces_ : word_pieces_;
+                    auto it = primary.find(piece);
+                    if (it != primary.end() || (it = secondary.find(piece)) != secondary.end()) {
+                        id = it->second;
+                        break;
+                    }
+                }
+                if (id < 0) {
+                    return false;
+                }
+                ids.push_back(id);
+                pos += length;
+            }
+            return true;
+        }
 
-            std::string total = "";
-            for (int i = 0; i < steps; i++) {
-                int deal_size = chunk_size;
-                if (i == steps - 1) {
-                    cache_->is_final = true;
-                    deal_size = speech_length - i * chunk_size;
+        std::shared_ptr<const HotwordTrie> Asr::compile_hotwords(const std::vector<std::string>& hotwords, float score) const {
+            std::shared_ptr<HotwordTrie> trie(new HotwordTrie);
+            trie->score = score;
+            for (const auto& hotword : hotwords) {
+                std::vector<int> ids;
+                std::istringstream words(hotword);
+                std::string word;
+                bool ok = true;
+                while (ok && words >> word) {
+                    std::vector<int> word_ids;
+                    if (!split_hotword(word, word_ids)) {
+                        std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return std::tolower(c); });
+                        ok = split_hotword(word, word_ids);
+                    }
+                    ids.insert(ids.end(), word_ids.begin(), word_ids.end());
                 }
+                if (!ok || ids.empty()) {
+                    MNN_PRINT("hotword not in vocabulary: %s\n", hotword.c_str());
+                    continue;
+                }
+                int node = 0;
+                for (int id : ids) {
+                    auto it = trie->nodes[node].children.find(id);
+                    if (it != trie->nodes[node].children.end()) {
+                        node = it->second;
+                        continue;
+                    }
+                    int child = static_cast<int>(trie->nodes.size());
+                    trie->nodes[node].children[id] = child;
+                    trie->nodes.emplace_back();
+                    node = child;
+                }
+            }
+            if (trie->nodes.size() == 1) {
+                return nullptr;
+            }
+            return trie;
+        }
 
-                auto chunk = _Slice(speech, _var<int>({i * chunk_size + start}, {1}), _var<int>({deal_size}, {1}));
-                auto res = recognize(chunk);
+        int Asr::sample_rate() const {
+            return config_->samp_freq();
+        }
 
-                total += res;
+        VadOptions Asr::vad_options() const {
+            VadOptions options;
+            options.sample_rate = config_->samp_freq();
+            options.threshold_db = config_->vad_threshold_db();
+            options.min_energy_db = config_->vad_min_energy_db();
+            options.min_speech_ms = config_->vad_min_speech_ms();
+            options.min_silence_ms = config_->vad_min_silence_ms();
+            options.pad_ms = config_->vad_pad_ms();
+            return options;
+        }
 
-                if (on_partial) {
-                    on_partial(res);
+        std::shared_ptr<AsrStream> Asr::create_stream() {
+            return create_stream(config_->vad());
+        }
+
+        std::shared_ptr<AsrStream> Asr::create_stream(bool vad) {
+            return std::shared_ptr<AsrStream>(new AsrStream(this, vad));
+        }
+
+        AsrStream::AsrStream(Asr* asr, bool vad) : asr_(asr) {
+            // expression ops of each stream run on its own executor, so streams can be
+            // driven from different threads; only the modules are shared
+            BackendConfig backend_config;
+            executor_ = Executor::newExecutor(MNN_FORWARD_CPU, backend_config, 1);
+            ExecutorScope scope(executor_);
+            cache_ = asr_->init_cache();
+            pending_.reserve(asr_->chunk_samples() * 2);
+            if (vad) {
+                auto options = asr_->vad_options();
+                vad_.reset(new Vad(options));
+                frame_.reserve(vad_->frame_samples());
+                history_keep_ = options.sample_rate / 1000 * (options.pad_ms + options.min_speech_ms) + vad_->frame_samples();
+            }
+        }
+
+        void AsrStream::run_chunk(const float* samples, size_t size, bool is_final) {
+            ExecutorScope scope(executor_);
+            cache_->is_final = is_final;
+            cache_->hotwords = hotwords_;
+            auto text = asr_->recognize(*cache_, samples, size);
+            partial_ += text;
+            total_ += text;
+            segment_text_ += text;
+            // token times are relative to the cache, which starts with the segment
+            float offset = segment_start_ / static_cast<float>(asr_->sample_rate());
+            for (auto& token : cache_->emitted) {
+                token.start += offset;
+                token.end += offset;
+                tokens_.push_back(token);
+                segment_tokens_.push_back(std::move(token));
+            }
+            cache_->emitted.clear();
+        }
+
+        void AsrStream::push_speech(const float* samples, size_t size) {
+            pending_.insert(pending_.end(), samples, samples + size);
+            size_t chunk_size = asr_->chunk_samples();
+            size_t consumed = 0;
+            while (pending_.size() - consumed >= chunk_size) {
+                run_chunk(pending_.data() + consumed, chunk_size, false);
+                consumed += chunk_size;
+            }
+            pending_.erase(pending_.begin(), pending_.begin() + consumed);
+            pending_start_ += consumed;
+        }
+
+        void AsrStream::accept_frame(const float* frame) {
+            int frame_samples = vad_->frame_samples();
+            samples_seen_ += frame_samples;
+            auto event = vad_->accept_frame(frame);
+            if (in_segment_) {
+                push_speech(frame, frame_samples);
+                if (event == Vad::Event::SPEECH_END) {
+                    end_segment(vad_->segment_end() * frame_samples);
                 }
+                return;
             }
+            history_.insert(history_.end(), frame, frame + frame_samples);
+            if (event == Vad::Event::SPEECH_START) {
+                int64_t start = std::max(vad_->segment_start() * frame_samples, history_start_);
+                in_segment_ = true;
+                segment_start_ = start;
+                pending_start_ = start;
+                push_speech(history_.data() + (start - history_start_), samples_seen_ - start);
+                history_.clear();
+                history_start_ = samples_seen_;
+                return;
+            }
+            // silence is dropped, apart from what a segment start may reach back to
+            if (history_.size() > history_keep_) {
+                size_t drop = history_.size() - history_keep_;
+                history_.erase(history_.begin(), history_.begin() + drop);
+                history_start_ += drop;
+            }
+        }
 
-            if (on_final) {
-                on_final(total);
+        void AsrStream::end_segment(int64_t end_sample) {
+            // trailing silence past the segment's pad is not decoded
+            size_t keep = static_cast<size_t>(std::max<int64_t>(0, std::min<int64_t>(end_sample - pending_start_, pending_.size())));
+            run_chunk(pending_.data(), keep, true);
+            float rate = static_cast<float>(asr_->sample_rate());
+            segments_.push_back({segment_start_ / rate, end_sample / rate, segment_text_, std::move(segment_tokens_)});
+            segment_text_.clear();
+            segment_tokens_.clear();
+            pending_.clear();
+            in_segment_ = false;
+            history_.clear();
+            history_start_ = samples_seen_;
+            // the next segment starts from a clean decoder state
+            ExecutorScope scope(executor_);
+            cache_ = asr_->init_cache();
+        }
+
+        void AsrStream::accept_waveform(const float* samples, size_t size) {
+            if (finalized_ || size == 0) {
+                return;
+            }
+            if (!vad_) {
+                samples_seen_ += size;
+                push_speech(samples, size);
+                return;
+            }
+            size_t frame_samples = vad_->frame_samples();
+            size_t offset = 0;
+            if (!frame_.empty()) {
+                size_t take = std::min(frame_samples - frame_.size(), size);
+                frame_.insert(frame_.end(), samples, samples + take);
+                offset = take;
+                if (frame_.size() < frame_samples) {
+                    return;
+                }
+                accept_frame(frame_.data());
+                frame_.clear();
+            }
+            for (; offset + frame_samples <= size; offset += frame_samples) {
+                accept_frame(samples + offset);
             }
+            frame_.insert(frame_.end(), samples + offset, samples + size);
+        }
+
+        std::string AsrStream::get_partial() {
+            std::string text;
+            text.swap(partial_);
+            return text;
+        }
+
+        void AsrStream::set_hotwords(const std::vector<std::string>& hotwords, float score) {
+            hotwords_ = hotwords.empty() ? nullptr : asr_->compile_hotwords(hotwords, score);
+            cache_->hotword_nodes.assign(1, 0);
+        }
+
+        std::vector<AsrToken> AsrStream::get_tokens() {
+            std::vector<AsrToken> tokens;
+            tokens.swap(tokens_);
+            return tokens;
+        }
+
+        std::vector<AsrSegment> AsrStream::get_segments() {
+            std::vector<AsrSegment> segments;
+            segments.swap(segments_);
+            return segments;
+        }
+
+        std::string AsrStream::finalize() {
+            if (finalized_) {
+                return total_;
+            }
+            if (!vad_) {
+                run_chunk(pending_.data(), pending_.size(), true);
+                float rate = static_cast<float>(asr_->sample_rate());
+                segments_.push_back({0.f, samples_seen_ / rate, segment_text_, std::move(segment_tokens_)});
+                segment_text_.clear();
+                segment_tokens_.clear();
+            } else if (in_segment_) {
+                // the unfinished frame still belongs to the open segment
+                samples_seen_ += frame_.size();
+                pending_.insert(pending_.end(), frame_.begin(), frame_.end());
+                end_segment(samples_seen_);
+            }
+            pending_.clear();
+            frame_.clear();
+            finalized_ = true;
+            return total_;
         }
 
         Asr *Asr::createASR(const std::string &config_path) {
@@ -510,6 +1131,18 @@ namespace MNN {
             chunk_size_ = config_->chunk_size();
             frontend_.reset(new WavFrontend(config_));
             tokenizer_.reset(Tokenizer::createTokenizer(config_->tokenizer_file()));
+            // surface forms for hotword lookup, "@@" marks a piece continued by the next one
+            for (int id = 0; id < tokenizer_->vocab_size(); id++) {
+                if (tokenizer_->is_special(id)) {
+                    continue;
+                }
+                auto symbol = tokenizer_->decode(id);
+                if (symbol.size() > 2 && symbol.compare(symbol.size() - 2, 2, "@@") == 0) {
+                    prefix_pieces_.emplace(symbol.substr(0, symbol.size() - 2), id);
+                } else if (!symbol.empty()) {
+                    word_pieces_.emplace(symbol, id);
+                }
+            }
             {
                 ScheduleConfig config;
                 BackendConfig cpuBackendConfig;
@@ -7,10 +7,39 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <vector>
 #include "mls_log.h"
+#include "nlohmann/json.hpp"
 #include "include/asr/asr.hpp"
 
 using namespace MNN::Transformer;
+using json = nlohmann::json;
+
+static json TokensToJson(const std::vector<AsrToken> &tokens) {
+    json result = json::array();
+    for (const auto &token : tokens) {
+        result.push_back({
+            {"text", token.text},
+            {"start_ms", static_cast<int64_t>(token.start * 1000)},
+            {"end_ms", static_cast<int64_t>(token.end * 1000)},
+            {"confidence", token.confidence}
+        });
+    }
+    return result;
+}
+
+static json SegmentsToJson(const std::vector<AsrSegment> &segments) {
+    json result = json::array();
+    for (const auto &segment : segments) {
+        result.push_back({
+            {"start_ms", static_cast<int64_t>(segment.start * 1000)},
+            {"end_ms", static_cast<int64_t>(segment.end * 1000)},
+            {"text", segment.text},
+            {"tokens", TokensToJson(segment.tokens)}
+        });
+    }
+    return result;
+}
 
 extern "C" {
 
@@ -49,6 +78,12 @@ Java_io_kindbrave_mnn_server_engine_MNNAsr_recognizeFromFileStreamNative(
     jclass callbackClass = env->GetObjectClass(callback);
     jmethodID onPartialResult = env->GetMethodID(callbackClass, "onPartialResult", "(Ljava/lang/String;)V");
     jmethodID onFinalResult = env->GetMethodID(callbackClass, "onFinalResult", "(Ljava/lang/String;)V");
+    // optional: callbacks built against the older interface have no onSegment
+    jmethodID onSegment = env->GetMethodID(callbackClass, "onSegment", "(JJLjava/lang/String;)V");
+    if (env->ExceptionCheck()) {
+        env->ExceptionClear();
+        onSegment = nullptr;
+    }
 
     // C++ lambda 回调
     asr->online_recognize_stream(
@@ -62,12 +97,145 @@ Java_io_kindbrave_mnn_server_engine_MNNAsr_recognizeFromFileStreamNative(
                 jstring jfinal = env->NewStringUTF(final_result.c_str());
                 env->CallVoidMethod(callback, onFinalResult, jfinal);
                 env->DeleteLocalRef(jfinal);
+            },
+            [&](const AsrSegment &segment) {
+                if (!onSegment) return;
+                jstring jtext = env->NewStringUTF(segment.text.c_str());
+                env->CallVoidMethod(callback, onSegment,
+                                    static_cast<jlong>(segment.start * 1000),
+                                    static_cast<jlong>(segment.end * 1000), jtext);
+                env->DeleteLocalRef(jtext);
             }
     );
 
     env->ReleaseStringUTFChars(wavFilePath, wav_path);
 }
 
+// Non-streaming recognition of a whole file, see Asr::offline_recognize.
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_recognizeFileNative(JNIEnv *env, jobject thiz,
+                                                              jlong asr_ptr,
+                                                              jstring wavFilePath) {
+    auto *asr = reinterpret_cast<Asr *>(asr_ptr);
+    if (!asr) return nullptr;
+    const char *wav_path = env->GetStringUTFChars(wavFilePath, nullptr);
+    auto text = asr->offline_recognize(wav_path);
+    env->ReleaseStringUTFChars(wavFilePath, wav_path);
+    return env->NewStringUTF(text.c_str());
+}
+
+// Same as recognizeFileNative, returning the segments with their token timestamps as JSON.
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_recognizeFileSegmentsNative(JNIEnv *env, jobject thiz,
+                                                                      jlong asr_ptr,
+                                                                      jstring wavFilePath) {
+    auto *asr = reinterpret_cast<Asr *>(asr_ptr);
+    if (!asr) return nullptr;
+    const char *wav_path = env->GetStringUTFChars(wavFilePath, nullptr);
+    std::vector<AsrSegment> segments;
+    asr->offline_recognize(wav_path, &segments);
+    env->ReleaseStringUTFChars(wavFilePath, wav_path);
+    return env->NewStringUTF(SegmentsToJson(segments).dump().c_str());
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_createStreamNative(JNIEnv *env, jobject thiz,
+                                                             jlong asr_ptr) {
+    auto *asr = reinterpret_cast<Asr *>(asr_ptr);
+    if (!asr) return 0;
+    // the handle owns a reference, released by releaseStreamNative
+    auto *stream = new std::shared_ptr<AsrStream>(asr->create_stream());
+    return reinterpret_cast<jlong>(stream);
+}
+
+// Reads samples straight from a direct ByteBuffer, byte_size bytes from byte_offset (the
+// buffer's position): native-order float32, or 16-bit PCM.
+JNIEXPORT void JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_acceptWaveformNative(JNIEnv *env, jobject thiz,
+                                                               jlong stream_ptr,
+                                                               jobject buffer,
+                                                               jint byte_offset,
+                                                               jint byte_size,
+                                                               jboolean pcm16) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    auto *base = static_cast<uint8_t *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (!stream || !base || byte_offset < 0 || byte_size <= 0 ||
+        static_cast<jlong>(byte_offset) + byte_size > capacity) return;
+    auto *data = base + byte_offset;
+    if (pcm16) {
+        size_t count = byte_size / sizeof(int16_t);
+        auto *pcm = reinterpret_cast<const int16_t *>(data);
+        thread_local std::vector<float> samples;
+        samples.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = pcm[i] / 32768.f;
+        }
+        (*stream)->accept_waveform(samples.data(), count);
+    } else {
+        (*stream)->accept_waveform(reinterpret_cast<const float *>(data), byte_size / sizeof(float));
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_setHotwordsNative(JNIEnv *env, jobject thiz,
+                                                            jlong stream_ptr,
+                                                            jobjectArray hotwords,
+                                                            jfloat score) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    if (!stream) return;
+    std::vector<std::string> words;
+    jsize count = hotwords ? env->GetArrayLength(hotwords) : 0;
+    for (jsize i = 0; i < count; i++) {
+        auto word = static_cast<jstring>(env->GetObjectArrayElement(hotwords, i));
+        const char *word_cstr = env->GetStringUTFChars(word, nullptr);
+        words.emplace_back(word_cstr);
+        env->ReleaseStringUTFChars(word, word_cstr);
+        env->DeleteLocalRef(word);
+    }
+    (*stream)->set_hotwords(words, score);
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_getPartialNative(JNIEnv *env, jobject thiz,
+                                                           jlong stream_ptr) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    if (!stream) return nullptr;
+    return env->NewStringUTF((*stream)->get_partial().c_str());
+}
+
+// Segments completed since the previous call: [{"start_ms", "end_ms", "text", "tokens"}]
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_getSegmentsNative(JNIEnv *env, jobject thiz,
+                                                            jlong stream_ptr) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    if (!stream) return nullptr;
+    return env->NewStringUTF(SegmentsToJson((*stream)->get_segments()).dump().c_str());
+}
+
+// Tokens decoded since the previous call: [{"text", "start_ms", "end_ms", "confidence"}]
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_getTokensNative(JNIEnv *env, jobject thiz,
+                                                          jlong stream_ptr) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    if (!stream) return nullptr;
+    return env->NewStringUTF(TokensToJson((*stream)->get_tokens()).dump().c_str());
+}
+
+JNIEXPORT jstring JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_finalizeNative(JNIEnv *env, jobject thiz,
+                                                         jlong stream_ptr) {
+    auto *stream = reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+    if (!stream) return nullptr;
+    return env->NewStringUTF((*stream)->finalize().c_str());
+}
+
+JNIEXPORT void JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNAsr_releaseStreamNative(JNIEnv *env, jobject thiz,
+                                                              jlong stream_ptr) {
+    delete reinterpret_cast<std::shared_ptr<AsrStream> *>(stream_ptr);
+}
+
 JNIEXPORT void JNICALL Java_io_kindbrave_mnn_server_engine_MNNAsr_releaseNative(
         JNIEnv* env,
         jobject thiz,
@@ -0,0 +1,255 @@
+//
+// Standalone CIF benchmark, built on the host without MNN:
+//   g++ -std=c++17 -O2 -I. -o cif_bench cif_bench.cpp
+//   ./cif_bench [hidden_size [chunks]]
+// or configure with -DMLS_BUILD_BENCH=ON. Runs the continuous integrate-and-fire step of
+// Asr::cif_search over streaming chunks of random encoder output (20 frames, [5, 10, 5]
+// chunk layout) and reports the per-chunk latency of two versions:
+//   per-frame: the search as it was before the native loop. The MNN expression graph can't
+//     run here, so this keeps its structure in plain loops: concat the carried frame, gather
+//     a copy of every frame, a new buffer for every multiply and add, and a final concat of
+//     the fired frames. It leaves out the graph overhead, so it is a lower bound on the old cost.
+//   native: the two passes of the current Asr::cif_search on the vector_simd.h kernels.
+// Both versions carry their own partial frame across chunks, and the fired frames are
+// compared after every chunk.
+//
+
+#include "vector_simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using mls::simd::AxpyF32;
+using mls::simd::ScaleF32;
+
+static constexpr int REPEAT = 5;
+static constexpr int CHUNK_BEGIN = 5;
+static constexpr int CHUNK_END = 15;
+static constexpr int LEN_TIME = 20;
+static constexpr float CIF_THRESHOLD = 1.0f;
+static constexpr float TAIL_THRESHOLD = 0.45f;
+
+struct Chunk {
+    std::vector<float> hidden;
+    std::vector<float> alphas;
+    bool last_chunk = false;
+};
+
+// partial frame carried into the next chunk
+struct CifCache {
+    std::vector<float> hidden;
+    float alpha = 0.f;
+};
+
+static double ElapsedMs(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// best of REPEAT runs, in milliseconds
+template <typename Fn>
+static double BestMs(Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < REPEAT; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, ElapsedMs(begin));
+    }
+    return best;
+}
+
+static std::vector<float> Add(const std::vector<float>& a, const std::vector<float>& b) {
+    std::vector<float> out(a.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        out[i] = a[i] + b[i];
+    }
+    return out;
+}
+
+static std::vector<float> Mul(float a, const std::vector<float>& x) {
+    std::vector<float> out(x.size());
+    for (size_t i = 0; i < x.size(); i++) {
+        out[i] = a * x[i];
+    }
+    return out;
+}
+
+// the search before the native loop, one temporary per expression node
+static std::vector<float> PerFrameCif(CifCache& cache, const Chunk& chunk, int hidden_size) {
+    std::vector<float> alphas(chunk.alphas);
+    for (int t = 0; t < LEN_TIME; t++) {
+        if (t < CHUNK_BEGIN || t >= CHUNK_END) {
+            alphas[t] = 0.f;
+        }
+    }
+    std::vector<float> hidden(cache.hidden);
+    hidden.insert(hidden.end(), chunk.hidden.begin(), chunk.hidden.end());
+    alphas.insert(alphas.begin(), cache.alpha);
+    if (chunk.last_chunk) {
+        hidden.resize(hidden.size() + hidden_size, 0.f);
+        alphas.push_back(TAIL_THRESHOLD);
+    }
+    int len_time = static_cast<int>(alphas.size());
+    std::vector<float> frames(hidden_size, 0.f);
+    float integrate = 0.f;
+    std::vector<std::vector<float>> list_frame;
+    for (int t = 0; t < len_time; t++) {
+        float alpha = alphas[t];
+        std::vector<float> hidden_t(hidden.begin() + t * hidden_size, hidden.begin() + (t + 1) * hidden_size);
+        if (alpha + integrate < CIF_THRESHOLD) {
+            integrate += alpha;
+            frames = Add(frames, Mul(alpha, hidden_t));
+        } else {
+            frames = Add(frames, Mul(CIF_THRESHOLD - integrate, hidden_t));
+            list_frame.push_back(frames);
+            integrate += alpha;
+            integrate -= CIF_THRESHOLD;
+            frames = Mul(integrate, hidden_t);
+        }
+    }
+    cache.alpha = integrate;
+    cache.hidden = integrate > 0.f ? Mul(1.f / integrate, frames) : frames;
+    std::vector<float> output;
+    for (auto& frame : list_frame) {
+        output.insert(output.end(), frame.begin(), frame.end());
+    }
+    return output;
+}
+
+// the two passes of Asr::cif_search
+static std::vector<float> NativeCif(CifCache& cache, const Chunk& chunk, int hidden_size) {
+    const float* hidden_ptr = chunk.hidden.data();
+    const float* alpha_ptr = chunk.alphas.data();
+    std::vector<float> tail_hidden;
+    if (chunk.last_chunk) {
+        tail_hidden.assign(hidden_size, 0.f);
+    }
+    int steps = LEN_TIME + 1 + (chunk.last_chunk ? 1 : 0);
+    auto step_alpha = [&](int s) {
+        if (s == 0) {
+            return cache.alpha;
+        }
+        int t = s - 1;
+        if (t == LEN_TIME) {
+            return TAIL_THRESHOLD;
+        }
+        return t >= CHUNK_BEGIN && t < CHUNK_END ? alpha_ptr[t] : 0.f;
+    };
+    auto step_hidden = [&](int s) {
+        if (s == 0) {
+            return static_cast<const float*>(cache.hidden.data());
+        }
+        return s - 1 == LEN_TIME ? tail_hidden.data() : hidden_ptr + (s - 1) * hidden_size;
+    };
+    int fire_count = 0;
+    float integrate = 0.f;
+    for (int s = 0; s < steps; s++) {
+        float alpha = step_alpha(s);
+        if (alpha + integrate < CIF_THRESHOLD) {
+            integrate += alpha;
+        } else {
+            fire_count++;
+            integrate += alpha;
+            integrate -= CIF_THRESHOLD;
+        }
+    }
+    std::vector<float> output(static_cast<size_t>(fire_count) * hidden_size, 0.f);
+    std::vector<float> remainder(hidden_size, 0.f);
+    int fired = 0;
+    float* frame = fire_count > 0 ? output.data() : remainder.data();
+    integrate = 0.f;
+    for (int s = 0; s < steps; s++) {
+        float alpha = step_alpha(s);
+        const float* hidden_t = step_hidden(s);
+        if (alpha + integrate < CIF_THRESHOLD) {
+            integrate += alpha;
+            if (alpha != 0.f) {
+                AxpyF32(alpha, hidden_t, frame, hidden_size);
+            }
+        } else {
+            AxpyF32(CIF_THRESHOLD - integrate, hidden_t, frame, hidden_size);
+            fired++;
+            frame = fired < fire_count ? output.data() + fired * hidden_size : remainder.data();
+            integrate += alpha;
+            integrate -= CIF_THRESHOLD;
+            ScaleF32(integrate, hidden_t, frame, hidden_size);
+        }
+    }
+    cache.alpha = integrate;
+    cache.hidden.resize(hidden_size);
+    ScaleF32(integrate > 0.f ? 1.f / integrate : 1.f, remainder.data(), cache.hidden.data(), hidden_size);
+    return output;
+}
+
+// random encoder output; alphas average ~0.35, so a token fires every ~3 frames like real speech
+static std::vector<Chunk> RandomChunks(int count, int hidden_size) {
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> value(-1.f, 1.f);
+    std::uniform_real_distribution<float> weight(0.f, 0.7f);
+    std::vector<Chunk> chunks(count);
+    for (int i = 0; i < count; i++) {
+        chunks[i].hidden.resize(static_cast<size_t>(LEN_TIME) * hidden_size);
+        for (auto& v : chunks[i].hidden) {
+            v = value(rng);
+        }
+        chunks[i].alphas.resize(LEN_TIME);
+        for (auto& a : chunks[i].alphas) {
+            a = weight(rng);
+        }
+        chunks[i].last_chunk = i == count - 1;
+    }
+    return chunks;
+}
+
+// runs every chunk as one stream and returns the number of fired frames
+template <typename Cif>
+static size_t RunStream(Cif cif, const std::vector<Chunk>& chunks, int hidden_size, std::vector<float>* fired) {
+    CifCache cache;
+    cache.hidden.assign(hidden_size, 0.f);
+    size_t frames = 0;
+    for (auto& chunk : chunks) {
+        auto output = cif(cache, chunk, hidden_size);
+        frames += output.size() / hidden_size;
+        if (fired) {
+            fired->insert(fired->end(), output.begin(), output.end());
+        }
+    }
+    return frames;
+}
+
+int main(int argc, char** argv) {
+    int hidden_size = argc > 1 ? atoi(argv[1]) : 512;
+    int count = argc > 2 ? atoi(argv[2]) : 2000;
+    if (hidden_size <= 0 || count <= 0) {
+        fprintf(stderr, "usage: %s [hidden_size [chunks]]\n", argv[0]);
+        return 1;
+    }
+    auto chunks = RandomChunks(count, hidden_size);
+
+    std::vector<float> reference, native;
+    size_t frames = RunStream(PerFrameCif, chunks, hidden_size, &reference);
+    if (RunStream(NativeCif, chunks, hidden_size, &native) != frames) {
+        fprintf(stderr, "fired frame counts differ\n");
+        return 1;
+    }
+    float max_diff = 0.f;
+    for (size_t i = 0; i < reference.size(); i++) {
+        max_diff = std::max(max_diff, std::fabs(reference[i] - native[i]));
+    }
+
+    double per_frame_ms = BestMs([&]() {
+        RunStream(PerFrameCif, chunks, hidden_size, nullptr);
+    });
+    double native_ms = BestMs([&]() {
+        RunStream(NativeCif, chunks, hidden_size, nullptr);
+    });
+    printf("cif: %d chunks x %d frames x %d dims, %zu fired, max diff %g\n",
+           count, LEN_TIME, hidden_size, frames, max_diff);
+    printf("per-frame %.2f us/chunk, native %.2f us/chunk\n",
+           per_frame_ms * 1e3 / count, native_ms * 1e3 / count);
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include "embedding_cache.h"
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mls {
+
+static constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv1a(const char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+PersistentVectorStore::~PersistentVectorStore() {
+    Close();
+}
+
+size_t PersistentVectorStore::SlotBytes() const {
+    return sizeof(uint64_t) + header_->dim * sizeof(float);
+}
+
+uint8_t* PersistentVectorStore::Slot(uint64_t index) const {
+    return reinterpret_cast<uint8_t*>(header_) + sizeof(Header) + index * SlotBytes();
+}
+
+bool PersistentVectorStore::Open(const std::string& path, int dim, uint64_t capacity) {
+    Close();
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+        Close();
+        return false;
+    }
+    Header existing{};
+    bool has_header = st.st_size >= static_cast<off_t>(sizeof(Header)) &&
+                      ::pread(fd_, &existing, sizeof(Header), 0) == sizeof(Header) &&
+                      existing.magic == MAGIC && existing.version == VERSION;
+    if (has_header) {
+        uint64_t expected = sizeof(Header) + existing.capacity * (sizeof(uint64_t) + static_cast<uint64_t>(existing.dim) * sizeof(float));
+        // a truncated or partly written file would SIGBUS on first access: rebuild it instead
+        if (existing.dim == 0 || existing.capacity == 0 || static_cast<uint64_t>(st.st_size) < expected) {
+            has_header = false;
+        }
+    }
+    if (has_header && (dim <= 0 || existing.dim == static_cast<uint32_t>(dim))) {
+        dim = static_cast<int>(existing.dim);
+        capacity = existing.capacity;
+    } else if (dim <= 0 || capacity == 0) {
+        Close();
+        return false;
+    } else {
+        // new store, or one written for another model dim: start over
+        has_header = false;
+    }
+    size_t size = sizeof(Header) + capacity * (sizeof(uint64_t) + dim * sizeof(float));
+    if (!has_header && (::ftruncate(fd_, 0) != 0 || ::ftruncate(fd_, static_cast<off_t>(size)) != 0)) {
+        Close();
+        return false;
+    }
+    void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (ptr == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    mapped_size_ = size;
+    header_ = reinterpret_cast<Header*>(ptr);
+    if (!has_header) {
+        header_->magic = MAGIC;
+        header_->version = VERSION;
+        header_->dim = static_cast<uint32_t>(dim);
+        header_->reserved = 0;
+        header_->capacity = capacity;
+        header_->count = 0;
+    }
+    return true;
+}
+
+void PersistentVectorStore::Close() {
+    if (header_ != nullptr) {
+        ::munmap(header_, mapped_size_);
+        header_ = nullptr;
+        mapped_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int PersistentVectorStore::Dim() const {
+    return header_ ? static_cast<int>(header_->dim) : 0;
+}
+
+uint64_t PersistentVectorStore::Count() const {
+    return header_ ? header_->count : 0;
+}
+
+bool PersistentVectorStore::Find(uint64_t key, float* out) const {
+    if (!header_) {
+        return false;
+    }
+    uint64_t capacity = header_->capacity;
+    for (uint64_t probe = 0; probe < capacity; probe++) {
+        uint8_t* slot = Slot((key + probe) % capacity);
+        uint64_t slot_key;
+        ::memcpy(&slot_key, slot, sizeof(uint64_t));
+        if (slot_key == 0) {
+            return false;
+        }
+        if (slot_key == key) {
+            ::memcpy(out, slot + sizeof(uint64_t), header_->dim * sizeof(float));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PersistentVectorStore::Insert(uint64_t key, const float* data) {
+    if (!header_) {
+        return false;
+    }
+    uint64_t capacity = header_->capacity;
+    // keep probe chains short: stop growing at 90% load
+    if (header_->count * 10 >= capacity * 9) {
+        return false;
+    }
+    for (uint64_t probe = 0; probe < capacity; probe++) {
+        uint8_t* slot = Slot((key + probe) % capacity);
+        uint64_t slot_key;
+        ::memcpy(&slot_key, slot, sizeof(uint64_t));
+        if (slot_key == key) {
+            return true;
+        }
+        if (slot_key == 0) {
+            // write the vector before publishing the key
+            ::memcpy(slot + sizeof(uint64_t), data, header_->dim * sizeof(float));
+            ::memcpy(slot, &key, sizeof(uint64_t));
+            header_->count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+EmbeddingCache::EmbeddingCache(const std::string& model_id, size_t max_bytes)
+        : model_seed_(fnv1a(model_id.data(), model_id.size(), FNV_OFFSET)), max_bytes_(max_bytes) {}
+
+bool EmbeddingCache::OpenPersistent(const std::string& path, uint64_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    persistent_path_ = path;
+    persistent_capacity_ = capacity;
+    // an existing file carries its own dim; a new one is created on the first insert
+    return persistent_.Open(path, 0, capacity);
+}
+
+uint64_t EmbeddingCache::Key(const std::string& text) const {
+    // normalize: trim and collapse whitespace runs, so formatting-only differences share an entry
+    uint64_t hash = model_seed_;
+    bool pending_space = false;
+    bool started = false;
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = started;
+            continue;
+        }
+        if (pending_space) {
+            hash = fnv1a(" ", 1, hash);
+            pending_space = false;
+        }
+        hash = fnv1a(&c, 1, hash);
+        started = true;
+    }
+    // 0 marks an empty slot in the persistent tier
+    return hash == 0 ? 1 : hash;
+}
+
+bool EmbeddingCache::Lookup(const std::string& text, std::vector<float>& output) {
+    uint64_t key = Key(text);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        output = it->second->vector;
+        stats_.hits++;
+        return true;
+    }
+    if (persistent_.IsOpen()) {
+        output.resize(persistent_.Dim());
+        if (persistent_.Find(key, output.data())) {
+            InsertLocked(key, output.data(), persistent_.Dim());
+            stats_.hits++;
+            stats_.persistent_hits++;
+            return true;
+        }
+    }
+    stats_.misses++;
+    return false;
+}
+
+void EmbeddingCache::Insert(const std::string& text, const float* data, int dim) {
+    uint64_t key = Key(text);
+    std::lock_guard<std::mutex> lock(mutex_);
+    InsertLocked(key, data, dim);
+    if (!persistent_path_.empty()) {
+        if (!persistent_.IsOpen() || persistent_.Dim() != dim) {
+            persistent_.Open(persistent_path_, dim, persistent_capacity_);
+        }
+        persistent_.Insert(key, data);
+    }
+}
+
+void EmbeddingCache::InsertLocked(uint64_t key, const float* data, int dim) {
+    size_t entry_bytes = dim * sizeof(float);
+    if (entry_bytes > max_bytes_) {
+        return;
+    }
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    while (bytes_ + entry_bytes > max_bytes_ && !lru_.empty()) {
+        bytes_ -= lru_.back().vector.size() * sizeof(float);
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+    lru_.push_front({key, std::vector<float>(data, data + dim)});
+    index_[key] = lru_.begin();
+    bytes_ += entry_bytes;
+}
+
+EmbeddingCache::Stats EmbeddingCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = static_cast<int64_t>(lru_.size());
+    stats.bytes = static_cast<int64_t>(bytes_);
+    return stats;
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mls {
+
+// Fixed-size vector store backed by an mmap'd file, indexed by open addressing on the
+// 64-bit text key. Layout: Header, then `capacity` slots of {uint64 key, float[dim]}.
+class PersistentVectorStore {
+public:
+    ~PersistentVectorStore();
+    // Maps an existing store, or creates one when dim > 0. Returns false when the file
+    // can't be mapped or was written for a different dim.
+    bool Open(const std::string& path, int dim, uint64_t capacity);
+    void Close();
+    bool IsOpen() const { return header_ != nullptr; }
+    int Dim() const;
+    bool Find(uint64_t key, float* out) const;
+    bool Insert(uint64_t key, const float* data);
+    uint64_t Count() const;
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t dim;
+        uint32_t reserved;
+        uint64_t capacity;
+        uint64_t count;
+    };
+    static constexpr uint32_t MAGIC = 0x4345564d; // "MVEC"
+    static constexpr uint32_t VERSION = 1;
+    size_t SlotBytes() const;
+    uint8_t* Slot(uint64_t index) const;
+    Header* header_{nullptr};
+    size_t mapped_size_{0};
+    int fd_{-1};
+};
+
+// LRU cache in front of EmbeddingSession, keyed by a hash of the normalized text and
+// the model id, bounded by the bytes held by cached vectors.
+class EmbeddingCache {
+public:
+    struct Stats {
+        int64_t hits = 0;
+        int64_t misses = 0;
+        int64_t persistent_hits = 0;
+        int64_t entries = 0;
+        int64_t bytes = 0;
+    };
+
+    EmbeddingCache(const std::string& model_id, size_t max_bytes);
+    bool OpenPersistent(const std::string& path, uint64_t capacity);
+    bool Lookup(const std::string& text, std::vector<float>& output);
+    void Insert(const std::string& text, const float* data, int dim);
+    Stats GetStats() const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::vector<float> vector;
+    };
+    uint64_t Key(const std::string& text) const;
+    void InsertLocked(uint64_t key, const float* data, int dim);
+
+    uint64_t model_seed_;
+    size_t max_bytes_;
+    size_t bytes_{0};
+    std::list<Entry> lru_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    std::string persistent_path_;
+    uint64_t persistent_capacity_{0};
+    PersistentVectorStore persistent_;
+    Stats stats_;
+    mutable std::mutex mutex_;
+};
+
+}
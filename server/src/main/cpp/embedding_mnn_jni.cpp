@@ -20,10 +20,33 @@
 #include "nlohmann/json.hpp"
 #include "utf8_stream_processor.hpp"
 #include "embedding_session.h"
+#include "embedding_postprocess.h"
 
 using MNN::Transformer::Embedding;
 using json = nlohmann::json;
 
+static std::vector<std::string> ToStrings(JNIEnv *env, jobjectArray texts) {
+    jsize count = env->GetArrayLength(texts);
+    std::vector<std::string> inputs;
+    inputs.reserve(count);
+    for (jsize i = 0; i < count; i++) {
+        auto text = (jstring)env->GetObjectArrayElement(texts, i);
+        const char *text_cstr = env->GetStringUTFChars(text, nullptr);
+        inputs.emplace_back(text_cstr);
+        env->ReleaseStringUTFChars(text, text_cstr);
+        env->DeleteLocalRef(text);
+    }
+    return inputs;
+}
+
+static mls::EmbeddingPostprocess MakePostprocess(jint truncate_dim, jboolean normalize, jint quantization) {
+    mls::EmbeddingPostprocess postprocess;
+    postprocess.truncate_dim = truncate_dim;
+    postprocess.normalize = normalize;
+    postprocess.quantization = static_cast<mls::EmbeddingQuantization>(quantization);
+    return postprocess;
+}
+
 extern "C" {
 
 JNIEXPORT jlong JNICALL Java_io_kindbrave_mnn_server_engine_MNNEmbedding_initNative(JNIEnv *env,
@@ -81,6 +104,163 @@ Java_io_kindbrave_mnn_server_engine_MNNEmbedding_embedding(JNIEnv *env, jobject
     return result;
 }
 
+extern "C"
+JNIEXPORT jfloatArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_embeddingBatch(JNIEnv *env, jobject thiz,
+                                                                jlong llm_ptr,
+                                                                jobjectArray texts) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding) {
+        return nullptr;
+    }
+    auto inputs = ToStrings(env, texts);
+    std::vector<float> output;
+    if (embedding->embed_batch(inputs, output) <= 0 && !inputs.empty()) {
+        return nullptr;
+    }
+    // one contiguous [count, dim] buffer, a single JNI copy for the whole batch
+    jfloatArray result = env->NewFloatArray(output.size());
+    env->SetFloatArrayRegion(result, 0, output.size(), output.data());
+    return result;
+}
+
+extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_embeddingEncoded(JNIEnv *env, jobject thiz,
+                                                                  jlong llm_ptr, jstring text,
+                                                                  jint truncate_dim,
+                                                                  jboolean normalize,
+                                                                  jint quantization) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding) {
+        return nullptr;
+    }
+    const char *text_cstr = env->GetStringUTFChars(text, nullptr);
+    MNN::Express::VARP vec = embedding->embedding(text_cstr);
+    env->ReleaseStringUTFChars(text, text_cstr);
+    if (vec.get() == nullptr) {
+        return nullptr;
+    }
+    auto postprocess = MakePostprocess(truncate_dim, normalize, quantization);
+    int dim = vec->getInfo()->size;
+    std::vector<uint8_t> row(postprocess.RowBytes(dim));
+    postprocess.Encode(vec->readMap<float>(), dim, row.data());
+    jbyteArray result = env->NewByteArray(row.size());
+    env->SetByteArrayRegion(result, 0, row.size(), reinterpret_cast<const jbyte *>(row.data()));
+    return result;
+}
+
+extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_embeddingBatchEncoded(JNIEnv *env, jobject thiz,
+                                                                       jlong llm_ptr,
+                                                                       jobjectArray texts,
+                                                                       jint truncate_dim,
+                                                                       jboolean normalize,
+                                                                       jint quantization) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding) {
+        return nullptr;
+    }
+    auto inputs = ToStrings(env, texts);
+    std::vector<float> output;
+    int dim = embedding->embed_batch(inputs, output);
+    if (dim <= 0 && !inputs.empty()) {
+        return nullptr;
+    }
+    auto postprocess = MakePostprocess(truncate_dim, normalize, quantization);
+    size_t row_bytes = dim > 0 ? postprocess.RowBytes(dim) : 0;
+    std::vector<uint8_t> encoded(row_bytes * inputs.size());
+    for (size_t i = 0; i < inputs.size() && dim > 0; i++) {
+        postprocess.Encode(output.data() + i * dim, dim, encoded.data() + i * row_bytes);
+    }
+    jbyteArray result = env->NewByteArray(encoded.size());
+    env->SetByteArrayRegion(result, 0, encoded.size(), reinterpret_cast<const jbyte *>(encoded.data()));
+    return result;
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_countTokens(JNIEnv *env, jobject thiz,
+                                                             jlong llm_ptr,
+                                                             jobjectArray texts) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding) {
+        return nullptr;
+    }
+    auto inputs = ToStrings(env, texts);
+    auto counts = embedding->count_tokens(inputs);
+    jintArray result = env->NewIntArray(counts.size());
+    env->SetIntArrayRegion(result, 0, counts.size(), counts.data());
+    return result;
+}
+
+// Tokenizes all texts in parallel. Returns the ids back to back and writes texts.size + 1
+// offsets into offsets_out: the ids of texts[i] are [offsets[i], offsets[i + 1]).
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_encodeBatch(JNIEnv *env, jobject thiz,
+                                                             jlong llm_ptr,
+                                                             jobjectArray texts,
+                                                             jintArray offsets_out) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding || env->GetArrayLength(offsets_out) < env->GetArrayLength(texts) + 1) {
+        return nullptr;
+    }
+    auto inputs = ToStrings(env, texts);
+    std::vector<int> ids, offsets;
+    embedding->encode_batch(inputs, ids, offsets);
+    env->SetIntArrayRegion(offsets_out, 0, offsets.size(), offsets.data());
+    jintArray result = env->NewIntArray(ids.size());
+    env->SetIntArrayRegion(result, 0, ids.size(), ids.data());
+    return result;
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_chunkByTokens(JNIEnv *env, jobject thiz,
+                                                               jlong llm_ptr, jstring text,
+                                                               jint max_tokens, jint overlap) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    if (!embedding) {
+        return nullptr;
+    }
+    // GetStringUTFChars returns modified UTF-8, which differs from real UTF-8 for NUL and
+    // supplementary characters; take the bytes from String.getBytes instead.
+    jclass string_class = env->GetObjectClass(text);
+    jmethodID get_bytes = env->GetMethodID(string_class, "getBytes", "(Ljava/lang/String;)[B");
+    jstring charset = env->NewStringUTF("UTF-8");
+    auto bytes = (jbyteArray)env->CallObjectMethod(text, get_bytes, charset);
+    jsize size = env->GetArrayLength(bytes);
+    std::string input(size, '\0');
+    env->GetByteArrayRegion(bytes, 0, size, reinterpret_cast<jbyte *>(&input[0]));
+    env->DeleteLocalRef(bytes);
+    env->DeleteLocalRef(charset);
+    env->DeleteLocalRef(string_class);
+    auto chunks = embedding->chunk_by_tokens(input, max_tokens, overlap);
+    std::vector<jint> offsets;
+    offsets.reserve(chunks.size() * 2);
+    for (auto& chunk : chunks) {
+        offsets.push_back(chunk.first);
+        offsets.push_back(chunk.second);
+    }
+    jintArray result = env->NewIntArray(offsets.size());
+    env->SetIntArrayRegion(result, 0, offsets.size(), offsets.data());
+    return result;
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNEmbedding_cacheStatsNative(JNIEnv *env, jobject thiz,
+                                                                  jlong llm_ptr) {
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(llm_ptr);
+    auto stats = embedding ? embedding->cache_stats() : mls::EmbeddingCache::Stats();
+    jlong values[] = {stats.hits, stats.misses, stats.persistent_hits, stats.entries, stats.bytes};
+    jlongArray result = env->NewLongArray(5);
+    env->SetLongArrayRegion(result, 0, 5, values);
+    return result;
+}
+
 JNIEXPORT void JNICALL Java_io_kindbrave_mnn_server_engine_MNNEmbedding_releaseNative(JNIEnv* env,
                                                                                jobject thiz,
                                                                                jlong objecPtr) {
@@ -0,0 +1,72 @@
+#include "embedding_postprocess.h"
+#include "vector_simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mls {
+
+void L2Normalize(float* data, size_t size) {
+    float norm = std::sqrt(simd::DotF32(data, data, size));
+    if (norm > 0.0f) {
+        float inv = 1.0f / norm;
+        for (size_t i = 0; i < size; i++) {
+            data[i] *= inv;
+        }
+    }
+}
+
+float QuantizeInt8(const float* input, size_t size, int8_t* output) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < size; i++) {
+        max_abs = std::max(max_abs, std::fabs(input[i]));
+    }
+    float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+    float inv = 1.0f / scale;
+    for (size_t i = 0; i < size; i++) {
+        output[i] = static_cast<int8_t>(std::lround(input[i] * inv));
+    }
+    return scale;
+}
+
+int EmbeddingPostprocess::OutputDim(int dim) const {
+    return truncate_dim > 0 ? std::min(truncate_dim, dim) : dim;
+}
+
+size_t EmbeddingPostprocess::RowBytes(int dim) const {
+    size_t out_dim = OutputDim(dim);
+    switch (quantization) {
+        case EmbeddingQuantization::INT8:
+            return sizeof(float) + out_dim;
+        case EmbeddingQuantization::BINARY:
+            return (out_dim + 7) / 8;
+        default:
+            return out_dim * sizeof(float);
+    }
+}
+
+void EmbeddingPostprocess::Encode(const float* input, int dim, uint8_t* out) const {
+    int out_dim = OutputDim(dim);
+    if (quantization == EmbeddingQuantization::BINARY) {
+        // only the sign survives, normalizing can't change it
+        ::memset(out, 0, RowBytes(dim));
+        for (int i = 0; i < out_dim; i++) {
+            if (input[i] > 0.0f) {
+                out[i >> 3] |= static_cast<uint8_t>(0x80 >> (i & 7));
+            }
+        }
+        return;
+    }
+    std::vector<float> row(input, input + out_dim);
+    if (normalize) {
+        L2Normalize(row.data(), row.size());
+    }
+    if (quantization == EmbeddingQuantization::INT8) {
+        float scale = QuantizeInt8(row.data(), row.size(), reinterpret_cast<int8_t*>(out + sizeof(float)));
+        ::memcpy(out, &scale, sizeof(float));
+        return;
+    }
+    ::memcpy(out, row.data(), row.size() * sizeof(float));
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mls {
+
+enum class EmbeddingQuantization {
+    FLOAT32 = 0,
+    INT8 = 1,
+    BINARY = 2
+};
+
+// Per-request post-processing applied in order: truncate to the first truncate_dim
+// dims (Matryoshka), L2-normalize, quantize.
+struct EmbeddingPostprocess {
+    int truncate_dim = 0;
+    bool normalize = false;
+    EmbeddingQuantization quantization = EmbeddingQuantization::FLOAT32;
+
+    int OutputDim(int dim) const;
+    // Bytes of one encoded row:
+    //   FLOAT32: float[dim]
+    //   INT8:    float scale, then int8[dim] with value = q * scale
+    //   BINARY:  ceil(dim / 8) bytes, bit 7 of byte 0 is dim 0, set when the value is > 0
+    size_t RowBytes(int dim) const;
+    // Encodes one row of `dim` floats into `out`, which must hold RowBytes(dim) bytes.
+    void Encode(const float* input, int dim, uint8_t* out) const;
+};
+
+void L2Normalize(float* data, size_t size);
+
+// Symmetric per-vector quantization, returns the scale.
+float QuantizeInt8(const float* input, size_t size, int8_t* output);
+
+}
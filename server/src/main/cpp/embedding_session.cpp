@@ -6,14 +6,56 @@
 #include <utility>
 #include "MNN/MNNForwardType.h"
 #include "MNN/expr/ExecutorScope.hpp"
+#include "MNN/expr/NeuralNetWorkOp.hpp"
 #include "mls_log.h"
 #include "mls_config.h"
 #include "utf8_stream_processor.hpp"
 #include "llm_stream_buffer.hpp"
+#include "include/trace/mls_trace.hpp"
+#include "thread_pool.h"
 #include <audio/audio.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 namespace mls {
 
+// Decoded token text as it appears in the input: drops the word-piece continuation
+// marker and turns the sentencepiece / byte-level space markers into spaces.
+static std::string NormalizePiece(std::string piece) {
+    if (piece.compare(0, 2, "##") == 0) {
+        piece.erase(0, 2);
+    }
+    static const std::string markers[] = {"\xe2\x96\x81", "\xc4\xa0"};
+    for (auto& marker : markers) {
+        size_t pos;
+        while ((pos = piece.find(marker)) != std::string::npos) {
+            piece.replace(pos, marker.size(), " ");
+        }
+    }
+    size_t begin = piece.find_first_not_of(" \t\n\r");
+    return begin == std::string::npos ? "" : piece.substr(begin);
+}
+
+static std::string BaseDir(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? "./" : path.substr(0, pos + 1);
+}
+
+static size_t FindCaseless(const std::string& text, const std::string& piece, size_t from, size_t limit) {
+    for (size_t pos = from; pos + piece.size() <= text.size() && pos <= limit; pos++) {
+        size_t i = 0;
+        while (i < piece.size() && std::tolower(static_cast<unsigned char>(text[pos + i])) ==
+                                   std::tolower(static_cast<unsigned char>(piece[i]))) {
+            i++;
+        }
+        if (i == piece.size()) {
+            return pos;
+        }
+    }
+    return std::string::npos;
+}
+
 EmbeddingSession::EmbeddingSession(std::string model_path, json config, json extra_config):
         model_path_(std::move(model_path)), config_(std::move(config)), extra_config_(std::move(extra_config)) {
     max_new_tokens_ = config_.contains("max_new_tokens") ?  config_["max_new_tokens"].get<int>() : 2048;
@@ -38,6 +80,25 @@ void EmbeddingSession::Load() {
     embedding_->set_config(config_str);
     MNN_DEBUG("dumped config: %s", embedding_->dump_config().c_str());
     embedding_->load();
+    // The in-tree tokenizer is reentrant and appends in place, so encode_batch can shard it
+    // across the pool. It doesn't always split like the model's own one (the HF pre-tokenizer
+    // keeps '_'), so once loaded it tokenizes every path: single and batched embeddings, the
+    // text-keyed cache, token counts and chunking all see the same ids.
+    tokenizer_.reset(MNN::Transformer::Tokenizer::createTokenizer(
+            BaseDir(model_path_) + config_.value("tokenizer_file", std::string("tokenizer.txt"))));
+    if (!tokenizer_) {
+        MNN_DEBUG("embedding tokenizer not loaded, falling back to the model's tokenizer on one thread");
+    }
+
+    size_t cache_mb = extra_config_.contains("embedding_cache_mb") ? extra_config_["embedding_cache_mb"].get<size_t>() : 32;
+    if (cache_mb > 0) {
+        cache_.reset(new EmbeddingCache(model_path_, cache_mb * 1024 * 1024));
+        std::string cache_path = extra_config_.contains("embedding_cache_path") ? extra_config_["embedding_cache_path"].get<std::string>() : "";
+        uint64_t cache_capacity = extra_config_.contains("embedding_cache_capacity") ? extra_config_["embedding_cache_capacity"].get<uint64_t>() : 65536;
+        if (!cache_path.empty() && !cache_->OpenPersistent(cache_path, cache_capacity)) {
+            MNN_DEBUG("embedding cache %s will be created on first insert", cache_path.c_str());
+        }
+    }
 }
 
 EmbeddingSession::~EmbeddingSession() {
@@ -49,17 +110,253 @@ void EmbeddingSession::SetMaxNewTokens(int i) {
 }
 
 MNN::Express::VARP EmbeddingSession::embedding(const std::string& text_cstr) {
-    if (embedding_) {
-        return embedding_->txt_embedding(text_cstr);
+    if (!embedding_) {
+        return nullptr;
+    }
+    std::vector<float> cached;
+    if (cache_ && cache_->Lookup(text_cstr, cached)) {
+        return MNN::Express::_Const(cached.data(), {1, static_cast<int>(cached.size())}, MNN::Express::NCHW, halide_type_of<float>());
+    }
+    // same ids as embed_batch, so both paths agree on the vector the cache keeps
+    auto ids = encode(text_cstr);
+    MLS_TRACE_SCOPE("embedding", "forward");
+    auto vec = embedding_->ids_embedding(ids);
+    if (cache_ && vec.get() != nullptr) {
+        cache_->Insert(text_cstr, vec->readMap<float>(), vec->getInfo()->size);
+    }
+    return vec;
+}
+
+int EmbeddingSession::embed_batch(const std::vector<std::string>& texts, std::vector<float>& output) {
+    output.clear();
+    if (!embedding_ || texts.empty()) {
+        return 0;
+    }
+    int dim = 0;
+    std::vector<std::vector<float>> cached(texts.size());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < texts.size(); i++) {
+        if (cache_ && cache_->Lookup(texts[i], cached[i])) {
+            dim = static_cast<int>(cached[i].size());
+        } else {
+            order.push_back(i);
+        }
+    }
+    std::vector<int> ids, offsets;
+    encode_gather(order.size(), [&texts, &order](size_t k) -> const std::string& {
+        return texts[order[k]];
+    }, ids, offsets);
+    // Run inputs grouped by token length: consecutive forwards with the same shape
+    // reuse the resized module instead of re-planning memory for every call.
+    std::vector<size_t> runs(order.size());
+    for (size_t k = 0; k < runs.size(); k++) {
+        runs[k] = k;
+    }
+    std::stable_sort(runs.begin(), runs.end(), [&offsets](size_t a, size_t b) {
+        return offsets[a + 1] - offsets[a] < offsets[b + 1] - offsets[b];
+    });
+    {
+        MLS_TRACE_SCOPE("embedding", "forward_batch");
+        std::vector<int> input_ids;
+        for (auto k : runs) {
+            size_t index = order[k];
+            input_ids.assign(ids.begin() + offsets[k], ids.begin() + offsets[k + 1]);
+            auto vec = embedding_->ids_embedding(input_ids);
+            if (vec.get() == nullptr) {
+                MNN_ERROR("embedding forward failed for text %d", static_cast<int>(index));
+                output.clear();
+                return 0;
+            }
+            auto ptr = vec->readMap<float>();
+            cached[index].assign(ptr, ptr + vec->getInfo()->size);
+            dim = static_cast<int>(cached[index].size());
+            if (cache_) {
+                cache_->Insert(texts[index], cached[index].data(), dim);
+            }
+        }
+    }
+    output.resize(texts.size() * dim);
+    for (size_t i = 0; i < texts.size(); i++) {
+        if (cached[i].size() != dim) {
+            MNN_ERROR("embedding dim mismatch: %d vs %d", static_cast<int>(cached[i].size()), dim);
+            output.clear();
+            return 0;
+        }
+        ::memcpy(output.data() + i * dim, cached[i].data(), dim * sizeof(float));
+    }
+    return dim;
+}
+
+EmbeddingCache::Stats EmbeddingSession::cache_stats() const {
+    return cache_ ? cache_->GetStats() : EmbeddingCache::Stats();
+}
+
+std::vector<int> EmbeddingSession::count_tokens(const std::vector<std::string>& texts) {
+    std::vector<int> counts(texts.size(), 0);
+    if (!embedding_) {
+        return counts;
+    }
+    std::vector<int> ids, offsets;
+    encode_batch(texts, ids, offsets);
+    for (size_t i = 0; i < texts.size(); i++) {
+        counts[i] = offsets[i + 1] - offsets[i];
+    }
+    return counts;
+}
+
+std::vector<std::pair<int, int>> EmbeddingSession::chunk_by_tokens(const std::string& text, int max_tokens, int overlap) {
+    std::vector<std::pair<int, int>> chunks;
+    if (!embedding_ || text.empty()) {
+        return chunks;
+    }
+    auto ids = encode(text);
+    // Align every token to the input by searching its decoded text forward from the previous
+    // match. Tokens that can't be located before the first / after the last located one are
+    // the special tokens the tokenizer adds; the rest ([UNK], partial byte pieces) cover the
+    // text between the surrounding matches and get a span of their own there. The search
+    // window grows with the number of unlocated tokens so the cursor resyncs after a long
+    // unknown run instead of losing every later piece.
+    struct Span {
+        size_t begin;
+        size_t end;
+        int tokens;
+    };
+    std::vector<Span> spans;
+    size_t cursor = 0;
+    int pending = 0;
+    int leading = 0;
+    auto flush_pending = [&](size_t until) {
+        if (pending == 0) {
+            return;
+        }
+        if (until > cursor) {
+            spans.push_back({cursor, until, pending});
+        } else {
+            spans.back().tokens += pending;
+        }
+        pending = 0;
+    };
+    for (auto id : ids) {
+        auto piece = NormalizePiece(decode(id));
+        size_t window = 64 * (static_cast<size_t>(pending) + 1);
+        size_t pos = piece.empty() ? std::string::npos : FindCaseless(text, piece, cursor, cursor + window);
+        if (pos == std::string::npos) {
+            if (spans.empty()) {
+                leading++;
+            } else {
+                pending++;
+            }
+            continue;
+        }
+        if (!spans.empty()) {
+            flush_pending(pos);
+        }
+        spans.push_back({pos, pos + piece.size(), 1});
+        cursor = pos + piece.size();
+    }
+    // unlocated tokens facing remaining text are content, not the tokenizer's suffix
+    if (!spans.empty() && text.find_first_not_of(" \t\n\r", cursor) != std::string::npos) {
+        flush_pending(text.size());
+    }
+    if (spans.empty()) {
+        chunks.emplace_back(0, static_cast<int>(text.size()));
+        return chunks;
     }
-    return nullptr;
+    // trailing unlocated tokens are added to every chunk, like the leading ones
+    int budget = std::max(1, max_tokens - leading - pending);
+    overlap = std::max(0, std::min(overlap, budget - 1));
+    // a run of unlocated tokens longer than the budget is cut evenly by bytes (on UTF-8
+    // boundaries), so no chunk carries more than max_tokens
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (spans[i].tokens <= budget) {
+            continue;
+        }
+        Span span = spans[i];
+        int parts = (span.tokens + budget - 1) / budget;
+        std::vector<Span> split;
+        size_t begin = span.begin;
+        int carry = 0;
+        for (int part = 1; part <= parts; part++) {
+            size_t end = part == parts ? span.end : span.begin + (span.end - span.begin) * part / parts;
+            while (end < span.end && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+                end++;
+            }
+            carry += std::min(budget, span.tokens - (part - 1) * budget);
+            if (end > begin) {
+                split.push_back({begin, end, carry});
+                carry = 0;
+                begin = end;
+            }
+        }
+        split.back().tokens += carry;
+        spans.erase(spans.begin() + i);
+        spans.insert(spans.begin() + i, split.begin(), split.end());
+        i += split.size() - 1;
+    }
+    size_t start = 0;
+    while (start < spans.size()) {
+        size_t end = start;
+        int used = 0;
+        while (end < spans.size() && (end == start || used + spans[end].tokens <= budget)) {
+            used += spans[end].tokens;
+            end++;
+        }
+        chunks.emplace_back(static_cast<int>(spans[start].begin), static_cast<int>(spans[end - 1].end));
+        if (end == spans.size()) {
+            break;
+        }
+        size_t next = end;
+        int shared = 0;
+        while (next > start + 1 && shared + spans[next - 1].tokens <= overlap) {
+            next--;
+            shared += spans[next].tokens;
+        }
+        start = next;
+    }
+    return chunks;
 }
 
 std::vector<int> EmbeddingSession::encode(const std::string& query) {
-    if (embedding_) {
-        return embedding_->tokenizer_encode(query);
+    if (!embedding_) {
+        return {};
+    }
+    MLS_TRACE_SCOPE("embedding", "tokenize");
+    return tokenizer_ ? tokenizer_->encode(query) : embedding_->tokenizer_encode(query);
+}
+
+std::string EmbeddingSession::decode(int id) {
+    return tokenizer_ ? tokenizer_->decode(id) : embedding_->tokenizer_decode(id);
+}
+
+void EmbeddingSession::encode_batch(const std::vector<std::string>& texts, std::vector<int>& ids, std::vector<int>& offsets) {
+    encode_gather(texts.size(), [&texts](size_t i) -> const std::string& {
+        return texts[i];
+    }, ids, offsets);
+}
+
+void EmbeddingSession::encode_gather(size_t n, const std::function<const std::string&(size_t)>& text_at,
+                                     std::vector<int>& ids, std::vector<int>& offsets) {
+    if (!embedding_) {
+        ids.clear();
+        offsets.assign(n + 1, 0);
+        return;
+    }
+    MLS_TRACE_SCOPE("embedding", "tokenize");
+    if (tokenizer_) {
+        // each text is encoded straight into its shard's buffer
+        mls::ThreadPool::Shared().ParallelGather<int>(n, [this, &text_at](size_t i, std::vector<int>& out) {
+            tokenizer_->encode_append(text_at(i), out);
+        }, ids, offsets);
+        return;
+    }
+    // Embedding::tokenizer_encode makes no thread-safety promise, so it stays on this thread
+    ids.clear();
+    offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        auto tokens = embedding_->tokenizer_encode(text_at(i));
+        ids.insert(ids.end(), tokens.begin(), tokens.end());
+        offsets[i + 1] = static_cast<int>(ids.size());
     }
-    return {};
 }
 
 }
\ No newline at end of file
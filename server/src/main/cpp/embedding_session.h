@@ -2,10 +2,13 @@
 // Created by ruoyi.sdj on 2025/4/18.
 //
 #pragma once
+#include <functional>
 #include <vector>
 #include <string>
 #include "nlohmann/json.hpp"
 #include "llm/llm.hpp"
+#include "embedding_cache.h"
+#include "include/asr/tokenizer.hpp"
 
 using nlohmann::json;
 using MNN::Transformer::Embedding;
@@ -19,15 +22,35 @@ public:
     ~EmbeddingSession();
     void SetMaxNewTokens(int i);
     MNN::Express::VARP embedding(const std::string& text_cstr);
+    // Embeds all texts and writes the vectors row by row into output; returns the embedding dim,
+    // or 0 with output empty if any text failed.
+    int embed_batch(const std::vector<std::string>& texts, std::vector<float>& output);
+    // Every path tokenizes with the in-tree tokenizer when it loaded, with the model's otherwise.
     std::vector<int> encode(const std::string& query);
+    // Tokenizes all texts into one buffer: the ids of texts[i] are ids[offsets[i], offsets[i + 1]).
+    // Runs on the shared thread pool when the in-tree tokenizer loaded, serially otherwise.
+    void encode_batch(const std::vector<std::string>& texts, std::vector<int>& ids, std::vector<int>& offsets);
+    // Token count of every text, without running the model.
+    std::vector<int> count_tokens(const std::vector<std::string>& texts);
+    // Splits text into windows of at most max_tokens tokens (including the special tokens the
+    // tokenizer adds) sharing `overlap` tokens; returns UTF-8 byte ranges [begin, end) into text.
+    std::vector<std::pair<int, int>> chunk_by_tokens(const std::string& text, int max_tokens, int overlap);
+    EmbeddingCache::Stats cache_stats() const;
 
 private:
+    std::string decode(int id);
+    // encode_batch over n texts, text_at(i) giving the i-th
+    void encode_gather(size_t n, const std::function<const std::string&(size_t)>& text_at,
+                       std::vector<int>& ids, std::vector<int>& offsets);
     std::string response_string_for_debug{};
     std::string model_path_;
     json extra_config_{};
     json config_{};
     std::vector<float> waveform{};
     Embedding* embedding_{nullptr};
+    std::unique_ptr<EmbeddingCache> cache_{nullptr};
+    // the model's tokenizer.txt loaded in-tree, used by every path; null if it could not be read
+    std::unique_ptr<MNN::Transformer::Tokenizer> tokenizer_{nullptr};
     std::string prompt_string_for_debug{};
     int max_new_tokens_{2048};
     std::string system_prompt_;
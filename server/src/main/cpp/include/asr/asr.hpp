@@ -15,7 +15,9 @@
 #include <sstream>
 #include <iostream>
 #include <streambuf>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <unordered_map>
 
 #include <MNN/expr/Expr.hpp>
@@ -23,42 +25,156 @@
 #include <MNN/expr/MathOp.hpp>
 #include <MNN/expr/NeuralNetWorkOp.hpp>
 
+#include "vad.hpp"
+
 namespace MNN {
     namespace Transformer {
         class AsrConfig;
         class Tokenizer;
         class WavFrontend;
         class OnlineCache;
+        struct HotwordTrie;
+
+        class Asr;
+
+        // A decoded token, times in seconds from the start of the stream. The span is the CIF
+        // integration range of the token, confidence its softmax probability.
+        struct AsrToken {
+            std::string text;
+            float start = 0.f;
+            float end = 0.f;
+            float confidence = 0.f;
+        };
+
+        // A stretch of speech and its text, times in seconds from the start of the stream.
+        struct AsrSegment {
+            float start;
+            float end;
+            std::string text;
+            std::vector<AsrToken> tokens;
+        };
+
+        // Push-based recognition of one audio stream. Samples are buffered up to the encoder
+        // chunk boundary and recognized as soon as a full chunk is available. With VAD on,
+        // silence is never sent to the model and each speech segment is decoded on its own.
+        class MNN_PUBLIC AsrStream {
+        public:
+            ~AsrStream() = default;
+            // mono 16 kHz samples in [-1, 1]
+            void accept_waveform(const float* samples, size_t size);
+            // text recognized since the previous call
+            std::string get_partial();
+            // boosts the rest of these words or phrases once decoding has produced their first
+            // piece, an empty list turns biasing off
+            void set_hotwords(const std::vector<std::string>& hotwords, float score);
+            // tokens decoded since the previous call
+            std::vector<AsrToken> get_tokens();
+            // segments completed since the previous call
+            std::vector<AsrSegment> get_segments();
+            // recognizes the buffered tail and returns the text of the whole stream
+            std::string finalize();
+        private:
+            friend class Asr;
+            AsrStream(Asr* asr, bool vad);
+            void run_chunk(const float* samples, size_t size, bool is_final);
+            void push_speech(const float* samples, size_t size);
+            void accept_frame(const float* frame);
+            void end_segment(int64_t end_sample);
+            Asr* asr_;
+            std::shared_ptr<Express::Executor> executor_;
+            // per-stream decoding state: overlap feats, CIF carry, FSMN states and tokens
+            std::shared_ptr<OnlineCache> cache_;
+            std::vector<float> pending_;
+            std::string partial_;
+            std::string total_;
+            bool finalized_ = false;
+            // VAD state, all sample positions count from the start of the stream
+            std::unique_ptr<Vad> vad_;
+            std::vector<float> frame_;
+            // recent audio while outside a segment, to recover the segment's leading pad
+            std::vector<float> history_;
+            size_t history_keep_ = 0;
+            int64_t history_start_ = 0;
+            int64_t samples_seen_ = 0;
+            // position of pending_[0]
+            int64_t pending_start_ = 0;
+            bool in_segment_ = false;
+            int64_t segment_start_ = 0;
+            std::string segment_text_;
+            std::vector<AsrToken> segment_tokens_;
+            std::vector<AsrToken> tokens_;
+            std::vector<AsrSegment> segments_;
+            std::shared_ptr<const HotwordTrie> hotwords_;
+        };
 
         class MNN_PUBLIC Asr {
         public:
             static Asr* createASR(const std::string& config_path);
-            Asr(std::shared_ptr<AsrConfig> config) : config_(config), cache_(nullptr) {}
+            Asr(std::shared_ptr<AsrConfig> config) : config_(config) {}
             virtual ~Asr();
             void load();
+            // recognizes a whole utterance in one call
             std::string recognize(Express::VARP speech);
             void online_recognize(const std::string& wav_file);
             void online_recognize_stream(
                     const std::string &wav_file,
                     std::function<void(const std::string &)> on_partial,
-                    std::function<void(const std::string &)> on_final);
-            void offline_recognize(const std::string& wav_file);
+                    std::function<void(const std::string &)> on_final,
+                    std::function<void(const AsrSegment &)> on_segment = nullptr);
+            // recognizes a whole file: VAD segments are decoded in parallel and joined in order
+            std::string offline_recognize(const std::string& wav_file, std::vector<AsrSegment>* segments = nullptr);
+            // vad defaults to the "vad" config entry
+            std::shared_ptr<AsrStream> create_stream();
+            std::shared_ptr<AsrStream> create_stream(bool vad);
+            // samples per streaming chunk, chunk_size[1] frames of 60 ms
+            int chunk_samples() const { return chunk_size_[1] * 960; }
+            int sample_rate() const;
         private:
-            void init_cache(int batch_size = 1);
-            Express::VARP add_overlap_chunk(Express::VARP feats);
-            Express::VARP position_encoding(Express::VARP sample);
-            Express::VARPS cif_search(Express::VARP enc, Express::VARP alpha);
-            std::string decode(Express::VARP logits);
-            std::string infer(Express::VARP feats);
+            friend class AsrStream;
+            struct EncoderRequest {
+                Express::VARP feats;
+                Express::VARPS outputs;
+                bool done = false;
+            };
+            VadOptions vad_options() const;
+            bool split_hotword(const std::string& word, std::vector<int>& ids) const;
+            std::shared_ptr<const HotwordTrie> compile_hotwords(const std::vector<std::string>& hotwords, float score) const;
+            std::shared_ptr<OnlineCache> init_cache(int batch_size = 1);
+            std::string recognize(OnlineCache& cache, const float* samples, size_t size);
+            Express::VARP add_overlap_chunk(OnlineCache& cache, Express::VARP feats);
+            Express::VARP position_encoding(OnlineCache& cache, Express::VARP sample);
+            std::vector<const float*> position_rows(int begin, int length, int feat_dims);
+            // writes the fired acoustic embeddings [1, n, hidden] and returns n
+            int cif_search(OnlineCache& cache, Express::VARP enc, Express::VARP alpha, Express::VARP& acoustic_embeds);
+            std::string decode(OnlineCache& cache, Express::VARP logits);
+            std::string infer(OnlineCache& cache, Express::VARP feats);
+            Express::VARPS encode(Express::VARP feats);
+            void run_encoder_batch(std::vector<EncoderRequest*>& requests);
         private:
             std::shared_ptr<AsrConfig> config_;
             std::shared_ptr<Tokenizer> tokenizer_;
             std::shared_ptr<WavFrontend> frontend_;
             std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime_manager_;
             std::vector<std::shared_ptr<MNN::Express::Module>> modules_;
-            std::shared_ptr<OnlineCache> cache_;
+            // modules_ are shared by all streams: encoder calls are combined into batches,
+            // decoder calls are serialized
+            std::mutex encoder_mutex_;
+            std::condition_variable encoder_cv_;
+            std::vector<EncoderRequest*> encoder_queue_;
+            bool encoder_busy_ = false;
+            std::mutex decoder_mutex_;
+            // sinusoidal position table, grown on demand up to POSITION_MAX_BLOCKS blocks
+            // (about 4 minutes of 60 ms LFR frames, ~9 MB at 560 dims)
+            static constexpr int POSITION_BLOCK = 1024;
+            static constexpr int POSITION_MAX_BLOCKS = 4;
+            std::mutex position_mutex_;
+            std::vector<std::unique_ptr<float[]>> position_blocks_;
+            int position_dims_ = 0;
             int feats_dims_;
             std::vector<int> chunk_size_;
+            // vocabulary surfaces for hotwords: whole pieces, and "xx@@" pieces without the marker
+            std::unordered_map<std::string, int> word_pieces_;
+            std::unordered_map<std::string, int> prefix_pieces_;
         };
 
     }
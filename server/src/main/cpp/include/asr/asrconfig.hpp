@@ -231,6 +231,32 @@ namespace MNN {
             }
             // backend config end >
 
+            // < vad config start
+            bool vad() const {
+                return config_.value("vad", true);
+            }
+
+            float vad_threshold_db() const {
+                return config_.value("vad_threshold_db", 12.f);
+            }
+
+            float vad_min_energy_db() const {
+                return config_.value("vad_min_energy_db", -50.f);
+            }
+
+            int vad_min_speech_ms() const {
+                return config_.value("vad_min_speech_ms", 30);
+            }
+
+            int vad_min_silence_ms() const {
+                return config_.value("vad_min_silence_ms", 500);
+            }
+
+            int vad_pad_ms() const {
+                return config_.value("vad_pad_ms", 200);
+            }
+            // vad config end >
+
             // < asr model config start
             int encoder_output_size() const {
                 return asr_config_.value("encoder_output_size", 512);
@@ -15,6 +15,8 @@
 #include <iostream>
 // #include <string_view>
 #include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
 class string_view_ {
 public:
     string_view_() : data_(nullptr), size_(0) {}
@@ -63,6 +65,89 @@ namespace MNN {
     namespace Transformer {
 // std::string_view impl in c++11 start
 
+        // One typed array of the binary tokenizer format; on load it points into the mapped file.
+        struct TokenizerSection {
+            uint32_t id;
+            const void* data;
+            size_t size;
+        };
+        using TokenizerSections = std::vector<TokenizerSection>;
+        // buffers built only for saving, kept alive until the file is written
+        using SectionStorage = std::vector<std::shared_ptr<const void>>;
+
+        // Array that owns its elements, or borrows them from a mapped binary tokenizer.
+        template <typename T>
+        class array_ref_ {
+        public:
+            array_ref_() = default;
+            array_ref_(const array_ref_&) = delete;
+            array_ref_& operator=(const array_ref_&) = delete;
+            void assign(std::vector<T>&& values) {
+                owned_ = std::move(values);
+                data_ = owned_.data();
+                size_ = owned_.size();
+            }
+            bool borrow(const TokenizerSection* section) {
+                if (section == nullptr || section->size % sizeof(T) != 0) {
+                    return false;
+                }
+                owned_.clear();
+                data_ = static_cast<const T*>(section->data);
+                size_ = section->size / sizeof(T);
+                return true;
+            }
+            void save(uint32_t id, TokenizerSections& sections) const {
+                sections.push_back({id, data_, size_ * sizeof(T)});
+            }
+            const T& operator[](size_t i) const { return data_[i]; }
+            const T* data() const { return data_; }
+            size_t size() const { return size_; }
+            bool empty() const { return size_ == 0; }
+        private:
+            std::vector<T> owned_;
+            const T* data_ = nullptr;
+            size_t size_ = 0;
+        };
+
+        // Token strings as one blob plus offsets, so they can be mapped instead of parsed.
+        class TokenTable {
+        public:
+            void assign(const std::vector<std::string>& tokens);
+            std::string get(int id) const;
+            int size() const { return offsets_.empty() ? 0 : static_cast<int>(offsets_.size()) - 1; }
+            void save(uint32_t first_id, TokenizerSections& sections) const;
+            bool load(uint32_t first_id, const TokenizerSections& sections);
+        private:
+            array_ref_<uint32_t> offsets_;
+            array_ref_<char> blob_;
+        };
+
+        // Byte trie over a vocabulary, stored flat: the children of a node are contiguous and
+        // sorted by label, so a greedy longest match is one walk over the input.
+        class ByteTrie {
+        public:
+            // keys[i] gets id i; for duplicate keys the lowest id wins
+            void build(const std::vector<std::string>& keys);
+            void save(uint32_t first_id, TokenizerSections& sections) const;
+            bool load(uint32_t first_id, const TokenizerSections& sections);
+            // node reached from node by byte c, or -1
+            int child(int node, unsigned char c) const;
+            // node reached from node by the whole key, or -1
+            int walk(int node, const char* key, size_t size) const;
+            // id of the longest key continuing node that prefixes data, or -1; its length is
+            // written to length
+            int longest_prefix(const char* data, size_t size, size_t* length, int node = 0) const;
+            bool empty() const { return value_.empty(); }
+        private:
+            void index_root();
+            array_ref_<int> first_child_;
+            array_ref_<int> child_count_;
+            array_ref_<unsigned char> label_;
+            array_ref_<int> value_;
+            // children of the root by byte
+            int root_[256];
+        };
+
         class Tokenizer {
         public:
             static constexpr int MAGIC_NUMBER = 430;
@@ -74,27 +159,95 @@ namespace MNN {
             };
             Tokenizer() = default;
             virtual ~Tokenizer() = default;
+            // Loads filename, or its compiled form filename + ".bin" when that was compiled from
+            // the current text file (same size and mtime); the compiled form is written on the
+            // first text load.
             static Tokenizer* createTokenizer(const std::string& filename);
-            bool is_stop(int token);
-            bool is_special(int token);
+            // Writes the binary format, which is mapped on load instead of parsed.
+            bool save_binary(const std::string& filename) const;
+            bool is_stop(int token) const {
+                return token >= 0 && token < static_cast<int>(token_flags_.size()) && (token_flags_[token] & STOP_FLAG);
+            }
+            bool is_special(int token) const {
+                return token >= 0 && token < static_cast<int>(token_flags_.size()) && (token_flags_[token] & SPECIAL_FLAG);
+            }
             std::vector<int> encode(const std::string& str);
+            // Encodes all texts on the shared thread pool into one buffer: the ids of texts[i]
+            // are ids[offsets[i], offsets[i + 1]).
+            void encode_batch(const std::vector<std::string>& texts, std::vector<int>& ids, std::vector<int>& offsets);
+            // encode() appending to ids instead of returning a new vector; the encode paths only
+            // read the vocab tables and keep their scratch thread_local, so this is reentrant
+            void encode_append(const std::string& str, std::vector<int>& ids);
             virtual std::string decode(int id) = 0;
+            virtual int vocab_size() const = 0;
         protected:
             virtual void load_special(std::ifstream& file);
             virtual bool load_vocab(std::ifstream& file) = 0;
             virtual void encode(const std::string& str, std::vector<int>& ids) = 0;
+            // binary format sections of each tokenizer type
+            enum SectionId : uint32_t {
+                SPECIAL_TOKENS = 1,
+                STOP_TOKENS = 2,
+                PREFIX_TOKENS = 3,
+                TOKENS = 16,          // 2 sections: offsets, blob
+                TRIE = 18,            // 4 sections
+                BPE_MERGES = 22,
+                BPE_BYTE_IDS = 23,
+                PIECE_SCORES = 24,
+                PIECE_TYPES = 25
+            };
+            virtual void save_sections(TokenizerSections& sections, SectionStorage& storage) const = 0;
+            virtual bool load_sections(const TokenizerSections& sections) = 0;
             std::vector<int> special_tokens_;
             std::vector<int> stop_tokens_;
             std::vector<int> prefix_tokens_;
+        private:
+            static Tokenizer* create(int type);
+            // source: stat of the text file the binary must have been compiled from, or nullptr
+            static Tokenizer* load_binary(const std::string& filename, const struct stat* source);
+            int type_ = -1;
+            // size and mtime of the text file this was parsed from, recorded in save_binary
+            uint64_t source_size_ = 0;
+            int64_t source_mtime_ns_ = 0;
+            // the mapped binary file borrowed arrays point into
+            std::shared_ptr<const void> mapping_;
+            // Aho-Corasick automaton over the special token strings, built once after the vocab
+            // is loaded; encode() splits on the leftmost-longest match in a single scan.
+            struct SpecialNode {
+                std::vector<std::pair<unsigned char, int>> next;
+                int fail = 0;
+                int depth = 0;
+                // special id spelled by this node, or -1
+                int id = -1;
+                // nearest node on the fail chain that spells a special, or -1
+                int output = -1;
+            };
+            // per-id flags and decoded special strings, built once after the vocab is loaded
+            enum TokenFlag : uint8_t {
+                SPECIAL_FLAG = 1,
+                STOP_FLAG = 2
+            };
+            void index_special_tokens();
+            void build_special_matcher();
+            int special_step(int state, unsigned char c) const;
+            std::vector<SpecialNode> special_nodes_;
+            // transitions of the root, the state most bytes of plain text land in
+            int special_root_[256];
+            std::vector<uint8_t> token_flags_;
+            // decode() of each special_tokens_ entry
+            std::vector<std::string> special_strings_;
         };
 
         class Sentencepiece : public Tokenizer {
         public:
             Sentencepiece() = default;
             virtual std::string decode(int id) override;
+            virtual int vocab_size() const override { return static_cast<int>(sentence_pieces_.size()); }
         protected:
             virtual bool load_vocab(std::ifstream& file) override;
             virtual void encode(const std::string& str, std::vector<int>& ids) override;
+            virtual void save_sections(TokenizerSections& sections, SectionStorage& storage) const override;
+            virtual bool load_sections(const TokenizerSections& sections) override;
         private:
             enum ModelType {
                 UNIGRAM = 1,
@@ -138,17 +291,21 @@ namespace MNN {
             int piece_to_id(const std::string& w) const;
             std::string byte_to_piece(unsigned char c) const;
             EncodeResult bpe_encode(string_view_ str, float alpha = 0.f);
+            void add_piece(int index, const std::string& token, float score, PieceType type);
         };
 
         class Tiktoken : public Tokenizer {
         public:
             Tiktoken() = default;
             virtual std::string decode(int id) override;
+            virtual int vocab_size() const override { return decoder_.size(); }
         protected:
             virtual bool load_vocab(std::ifstream& file) override;
             virtual void encode(const std::string& str, std::vector<int>& ids) override;
-            std::unordered_map<std::string, int> encoder_;
-            std::vector<std::string> decoder_;
+            virtual void save_sections(TokenizerSections& sections, SectionStorage& storage) const override;
+            virtual bool load_sections(const TokenizerSections& sections) override;
+            ByteTrie trie_;
+            TokenTable decoder_;
         };
 
         class BertTokenizer : public Tiktoken {
@@ -161,28 +318,33 @@ namespace MNN {
         };
 
         class HuggingfaceTokenizer : public Tokenizer {
-            struct hash_pair_wstring {
-                size_t operator()(const std::pair<std::wstring, std::wstring>& p) const {
-                    auto hash1 = std::hash<std::wstring>{}(p.first);
-                    auto hash2 = std::hash<std::wstring>{}(p.second);
-                    // If hash1 == hash2, their XOR is zero.
-                    return (hash1 != hash2) ? hash1 ^ hash2 : hash1;
-                }
-            };
-            using BPERanks = std::unordered_map<std::pair<std::wstring, std::wstring>, int, hash_pair_wstring>;
         public:
-            HuggingfaceTokenizer() = default;
+            HuggingfaceTokenizer();
             virtual std::string decode(int id) override;
+            virtual int vocab_size() const override { return decoded_.size(); }
         protected:
             virtual bool load_vocab(std::ifstream& file) override;
             virtual void encode(const std::string& str, std::vector<int>& ids) override;
+            virtual void save_sections(TokenizerSections& sections, SectionStorage& storage) const override;
+            virtual bool load_sections(const TokenizerSections& sections) override;
         private:
-            void bpe(const std::wstring& token, const BPERanks& bpe_ranks, std::vector<std::wstring>* result);
-            BPERanks bpe_ranks_;
-            std::unordered_map<uint8_t, wchar_t> b2u_;
-            std::unordered_map<wchar_t, uint8_t> u2b_;
-            std::unordered_map<std::string, int> encoder_;
-            std::vector<std::string> decoder_;
+            // open addressing slot: (left id, right id) -> merge rank and merged id
+            struct Merge {
+                uint64_t key = 0;
+                int rank = -1;
+                int merged = -1;
+            };
+            bool find_merge(int left, int right, const Merge** merge) const;
+            // byte-level BPE of one pre-tokenized word, on vocab ids
+            void bpe(const char* data, size_t size, std::vector<int>& ids) const;
+            array_ref_<Merge> merges_;
+            size_t merge_mask_ = 0;
+            // vocab id of the single-symbol token of each byte, or -1
+            int byte_ids_[256];
+            // raw bytes of each token, decode() is a lookup
+            TokenTable decoded_;
+            // identifies this instance to the thread-local word cache
+            uint64_t instance_id_;
         };
     };
 };
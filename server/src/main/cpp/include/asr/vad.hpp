@@ -0,0 +1,64 @@
+//
+//  vad.hpp
+//
+
+#ifndef VAD_hpp
+#define VAD_hpp
+
+#include <cstdint>
+
+namespace MNN {
+    namespace Transformer {
+
+        struct VadOptions {
+            int sample_rate = 16000;
+            int frame_ms = 10;
+            // a frame is voiced when it is this much louder than the tracked noise floor
+            float threshold_db = 12.f;
+            // and louder than this absolute level (dBFS)
+            float min_energy_db = -50.f;
+            // voiced run that opens a segment, silent run that closes it
+            int min_speech_ms = 30;
+            int min_silence_ms = 500;
+            // audio kept on both sides of a segment
+            int pad_ms = 200;
+        };
+
+        // Energy VAD over fixed-size frames. The noise floor follows quiet frames quickly and
+        // loud ones slowly, so steady background noise is learned within a few seconds.
+        class Vad {
+        public:
+            enum class Event {
+                NONE,
+                SPEECH_START,
+                SPEECH_END
+            };
+            explicit Vad(const VadOptions& options);
+            // classifies the next frame of frame_samples() samples in [-1, 1]
+            Event accept_frame(const float* frame);
+            void reset();
+            int frame_samples() const { return frame_samples_; }
+            bool in_speech() const { return in_speech_; }
+            // frame range of the last opened / closed segment, padding included; the end
+            // is exclusive
+            int64_t segment_start() const { return segment_start_; }
+            int64_t segment_end() const { return segment_end_; }
+        private:
+            VadOptions options_;
+            int frame_samples_;
+            int speech_frames_;
+            int silence_frames_;
+            int pad_frames_;
+            float noise_db_;
+            bool in_speech_ = false;
+            int voiced_run_ = 0;
+            int silent_run_ = 0;
+            int64_t frame_index_ = 0;
+            int64_t segment_start_ = 0;
+            int64_t segment_end_ = 0;
+        };
+
+    }
+}
+
+#endif // VAD_hpp
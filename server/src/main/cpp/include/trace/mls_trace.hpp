@@ -0,0 +1,221 @@
+//
+//  mls_trace.hpp
+//
+//  Lightweight span tracing shared by the LLM, ASR, TTS and embedding pipelines.
+//  Every thread records into its own fixed-size ring buffer, so recording a span
+//  takes no lock and never allocates. Spans are exported as Chrome trace-event
+//  JSON which can be opened in chrome://tracing or ui.perfetto.dev.
+//
+//  Build with MLS_TRACE_ENABLED=0 to compile every MLS_TRACE_SCOPE away.
+//
+
+#ifndef MLS_TRACE_hpp
+#define MLS_TRACE_hpp
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifndef MLS_TRACE_ENABLED
+#define MLS_TRACE_ENABLED 1
+#endif
+
+namespace mls {
+    namespace trace {
+
+        struct Event {
+            const char* category = nullptr;
+            const char* name = nullptr;
+            int64_t begin_us = 0;
+            int64_t duration_us = 0;
+        };
+
+        inline int64_t now_us() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Single-producer ring buffer owned by one thread; older events are overwritten.
+        // Each slot carries a sequence number so a concurrent snapshot can tell a complete
+        // event from one the owner is rewriting: odd while writing, 2 * (index + 1) once done.
+        class ThreadBuffer {
+        public:
+            static constexpr uint64_t CAPACITY = 4096;
+            explicit ThreadBuffer(int tid) : tid_(tid) {}
+            void push(const Event& event) {
+                uint64_t head = head_.load(std::memory_order_relaxed);
+                Slot& slot = slots_[head & (CAPACITY - 1)];
+                slot.seq.store(2 * head + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.category.store(event.category, std::memory_order_relaxed);
+                slot.name.store(event.name, std::memory_order_relaxed);
+                slot.begin_us.store(event.begin_us, std::memory_order_relaxed);
+                slot.duration_us.store(event.duration_us, std::memory_order_relaxed);
+                slot.seq.store(2 * head + 2, std::memory_order_release);
+                head_.store(head + 1, std::memory_order_release);
+            }
+            // Copies the events that are still resident, skipping slots the owner
+            // thread rewrote while we were reading them.
+            void snapshot(std::vector<Event>& out) const {
+                uint64_t head = head_.load(std::memory_order_acquire);
+                uint64_t begin = head > CAPACITY ? head - CAPACITY : 0;
+                for (uint64_t i = begin; i < head; i++) {
+                    const Slot& slot = slots_[i & (CAPACITY - 1)];
+                    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+                    if (seq != 2 * i + 2) {
+                        continue;
+                    }
+                    Event event;
+                    event.category = slot.category.load(std::memory_order_relaxed);
+                    event.name = slot.name.load(std::memory_order_relaxed);
+                    event.begin_us = slot.begin_us.load(std::memory_order_relaxed);
+                    event.duration_us = slot.duration_us.load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                        out.push_back(event);
+                    }
+                }
+            }
+            int tid() const { return tid_; }
+        private:
+            struct Slot {
+                std::atomic<uint64_t> seq{0};
+                std::atomic<const char*> category{nullptr};
+                std::atomic<const char*> name{nullptr};
+                std::atomic<int64_t> begin_us{0};
+                std::atomic<int64_t> duration_us{0};
+            };
+            std::array<Slot, CAPACITY> slots_{};
+            std::atomic<uint64_t> head_{0};
+            int tid_;
+        };
+
+        class Registry {
+        public:
+            static Registry& get() {
+                static Registry registry;
+                return registry;
+            }
+            std::shared_ptr<ThreadBuffer> add_thread() {
+                auto buffer = std::make_shared<ThreadBuffer>(static_cast<int>(gettid()));
+                std::lock_guard<std::mutex> lock(mutex_);
+                buffers_.push_back(buffer);
+                return buffer;
+            }
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return buffers_;
+            }
+            // Frees the buffers of threads that have exited. Only the registry still holds
+            // those, and nothing can take a new reference while the lock is held.
+            void release_dead_threads() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                              [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                                  return buffer.use_count() == 1;
+                                              }),
+                               buffers_.end());
+            }
+            std::atomic<bool> enabled{false};
+            std::atomic<int64_t> epoch_us{0};
+        private:
+            std::mutex mutex_;
+            std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+        };
+
+        inline ThreadBuffer& local_buffer() {
+            // The registry keeps a reference too, so events survive thread exit until the
+            // next export or clear.
+            thread_local std::shared_ptr<ThreadBuffer> buffer = Registry::get().add_thread();
+            return *buffer;
+        }
+
+        inline bool is_enabled() {
+            return Registry::get().enabled.load(std::memory_order_relaxed);
+        }
+
+        inline void set_enabled(bool enabled) {
+            Registry::get().enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        // Drops everything recorded so far; later exports only contain newer spans.
+        inline void clear() {
+            Registry::get().epoch_us.store(now_us(), std::memory_order_relaxed);
+            Registry::get().release_dead_threads();
+        }
+
+        class ScopedSpan {
+        public:
+            ScopedSpan(const char* category, const char* name) {
+                if (is_enabled()) {
+                    event_.category = category;
+                    event_.name = name;
+                    event_.begin_us = now_us();
+                }
+            }
+            ~ScopedSpan() {
+                if (event_.name != nullptr) {
+                    event_.duration_us = now_us() - event_.begin_us;
+                    local_buffer().push(event_);
+                }
+            }
+            ScopedSpan(const ScopedSpan&) = delete;
+            ScopedSpan& operator=(const ScopedSpan&) = delete;
+        private:
+            Event event_;
+        };
+
+        // Exported spans of exited threads are released afterwards, so short-lived threads
+        // (one per streaming TTS call, for instance) do not keep their buffers forever.
+        inline bool export_chrome_json(const std::string& path) {
+            std::ofstream out(path);
+            if (!out.good()) {
+                return false;
+            }
+            int64_t epoch = Registry::get().epoch_us.load(std::memory_order_relaxed);
+            int pid = static_cast<int>(getpid());
+            std::vector<Event> events;
+            bool first = true;
+            out << "{\"traceEvents\":[";
+            for (auto& buffer : Registry::get().buffers()) {
+                events.clear();
+                buffer->snapshot(events);
+                for (auto& event : events) {
+                    if (event.begin_us < epoch) {
+                        continue;
+                    }
+                    out << (first ? "" : ",")
+                        << "{\"cat\":\"" << event.category << "\",\"name\":\"" << event.name
+                        << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << buffer->tid()
+                        << ",\"ts\":" << event.begin_us << ",\"dur\":" << event.duration_us << "}";
+                    first = false;
+                }
+            }
+            out << "]}";
+            bool ok = out.good();
+            if (ok) {
+                Registry::get().release_dead_threads();
+            }
+            return ok;
+        }
+
+    } // namespace trace
+} // namespace mls
+
+#if MLS_TRACE_ENABLED
+#define MLS_TRACE_CONCAT_IMPL(a, b) a##b
+#define MLS_TRACE_CONCAT(a, b) MLS_TRACE_CONCAT_IMPL(a, b)
+#define MLS_TRACE_SCOPE(category, name) ::mls::trace::ScopedSpan MLS_TRACE_CONCAT(mls_trace_span_, __LINE__)(category, name)
+#else
+#define MLS_TRACE_SCOPE(category, name) do {} while (0)
+#endif
+
+#endif // MLS_TRACE_hpp
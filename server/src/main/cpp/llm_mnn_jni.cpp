@@ -152,6 +152,15 @@ JNIEXPORT jobject JNICALL Java_io_kindbrave_mnn_server_engine_MNNLlm_submitNativ
     env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("audio_time"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), audio_time));
     env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("prefill_time"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), prefill_time));
     env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("decode_time"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), decode_time));
+
+    // Token-level timing: time to first token, inter-token latency percentiles and stalls
+    auto timing = llm->GetTokenTimingSummary();
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("ttft"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.ttft_us));
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("itl_p50"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.itl_p50_us));
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("itl_p90"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.itl_p90_us));
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("itl_p99"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.itl_p99_us));
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("itl_max"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.itl_max_us));
+    env->CallObjectMethod(hashMap, putMethod, env->NewStringUTF("stall_count"), env->NewObject(env->FindClass("java/lang/Long"), env->GetMethodID(env->FindClass("java/lang/Long"), "<init>", "(J)V"), timing.stall_count));
     return hashMap;
 }
 
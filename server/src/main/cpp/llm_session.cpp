@@ -10,6 +10,7 @@
 #include "mls_config.h"
 #include "utf8_stream_processor.hpp"
 #include "llm_stream_buffer.hpp"
+#include "include/trace/mls_trace.hpp"
 #include <audio/audio.hpp>
 
 namespace mls {
@@ -70,6 +71,10 @@ LlmSession::LlmSession(std::string model_path, json config, json extra_config, s
     keep_history_ = !extra_config_.contains("keep_history") || extra_config_["keep_history"].get<bool>();
     is_r1_ = extra_config_.contains("is_r1") && extra_config_["is_r1"].get<bool>();
     system_prompt_ = config_.contains("system_prompt") ? config_["system_prompt"].get<std::string>() : "You are a helpful assistant.";
+    if (extra_config_.contains("stall_threshold_ms")) {
+        stall_threshold_us_ = extra_config_["stall_threshold_ms"].get<int64_t>() * 1000;
+    }
+    token_trace_path_ = extra_config_.contains("token_trace_path") ? extra_config_["token_trace_path"].get<std::string>() : "";
     history_.emplace_back("system", GetSystemPromptString(system_prompt_, is_r1_));
     if (!history.empty()) {
         for (int i = 0; i < history.size(); i++) {
@@ -188,16 +193,30 @@ const MNN::Transformer::LlmContext * LlmSession::Response(
         prompt_string_for_debug += it.second;
     }
     MNN_DEBUG("submitNative prompt_string_for_debug count %s max_new_tokens_:%d", prompt_string_for_debug.c_str(), max_new_tokens_);
-    llm_->response(history_, &output_ostream, "<eop>", 1);
+    token_trace_.Begin(max_new_tokens_);
+    {
+        MLS_TRACE_SCOPE("llm", "prefill");
+        llm_->response(history_, &output_ostream, "<eop>", 1);
+    }
+    token_trace_.Mark();
     current_size++;
     while (!stop_requested_ && current_size < max_new_tokens_) {
+        MLS_TRACE_SCOPE("llm", "decode");
         llm_->generate(1);
+        token_trace_.Mark();
         current_size++;
     }
+    if (!token_trace_path_.empty() && !token_trace_.WriteChromeTrace(token_trace_path_)) {
+        MNN_ERROR("failed to write token trace to %s", token_trace_path_.c_str());
+    }
     auto context = llm_->getContext();
     return context;
 }
 
+TokenTimingTrace::Summary LlmSession::GetTokenTimingSummary() const {
+    return token_trace_.Summarize(stall_threshold_us_);
+}
+
 std::string LlmSession::getDebugInfo() {
     return ("last_prompt:\n" + prompt_string_for_debug + "\nlast_response:\n" + response_string_for_debug);
 }
@@ -6,6 +6,7 @@
 #include <string>
 #include "nlohmann/json.hpp"
 #include "llm/llm.hpp"
+#include "token_timing_trace.hpp"
 
 using nlohmann::json;
 using MNN::Transformer::Llm;
@@ -31,6 +32,8 @@ public:
 
     MNN::Express::VARP embedding(const std::string& text_cstr);
 
+    TokenTimingTrace::Summary GetTokenTimingSummary() const;
+
 private:
     std::string response_string_for_debug{};
     std::string model_path_;
@@ -46,6 +49,9 @@ private:
     int max_new_tokens_{2048};
     std::string system_prompt_;
     json current_config_{};
+    TokenTimingTrace token_trace_{};
+    int64_t stall_threshold_us_{200000};
+    std::string token_trace_path_{};
     void SetHistory(const std::vector<std::pair<std::string, std::string>>& history);
 };
 }
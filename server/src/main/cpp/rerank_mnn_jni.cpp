@@ -0,0 +1,72 @@
+#include <jni.h>
+#include <string>
+#include <vector>
+#include "mls_log.h"
+#include "nlohmann/json.hpp"
+#include "rerank_session.h"
+
+using json = nlohmann::json;
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNRerank_initNative(JNIEnv *env, jobject thiz,
+                                                         jstring config_path,
+                                                         jstring config_json_str) {
+    const char *config_path_cstr = env->GetStringUTFChars(config_path, nullptr);
+    const char *config_json_cstr = env->GetStringUTFChars(config_json_str, nullptr);
+    auto config_path_str = std::string(config_path_cstr);
+    json extra_json_config = json::parse(config_json_cstr, nullptr, false);
+    env->ReleaseStringUTFChars(config_path, config_path_cstr);
+    env->ReleaseStringUTFChars(config_json_str, config_json_cstr);
+    if (!extra_json_config.is_object()) {
+        extra_json_config = json::object();
+    }
+    MNN_DEBUG("createRerank BeginLoad %s", config_path_str.c_str());
+    auto session = new mls::RerankSession(config_path_str, extra_json_config);
+    if (!session->Load()) {
+        delete session;
+        return 0;
+    }
+    MNN_DEBUG("createRerank EndLoad %ld ", reinterpret_cast<jlong>(session));
+    return reinterpret_cast<jlong>(session);
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNRerank_scoreNative(JNIEnv *env, jobject thiz,
+                                                          jlong rerank_ptr, jstring query,
+                                                          jobjectArray passages) {
+    auto *session = reinterpret_cast<mls::RerankSession *>(rerank_ptr);
+    if (!session) {
+        return nullptr;
+    }
+    const char *query_cstr = env->GetStringUTFChars(query, nullptr);
+    std::string query_str(query_cstr);
+    env->ReleaseStringUTFChars(query, query_cstr);
+    jsize count = env->GetArrayLength(passages);
+    std::vector<std::string> inputs;
+    inputs.reserve(count);
+    for (jsize i = 0; i < count; i++) {
+        auto text = (jstring)env->GetObjectArrayElement(passages, i);
+        const char *text_cstr = env->GetStringUTFChars(text, nullptr);
+        inputs.emplace_back(text_cstr);
+        env->ReleaseStringUTFChars(text, text_cstr);
+        env->DeleteLocalRef(text);
+    }
+    auto scores = session->Score(query_str, inputs);
+    if (scores.size() != inputs.size()) {
+        return nullptr;
+    }
+    jfloatArray result = env->NewFloatArray(scores.size());
+    env->SetFloatArrayRegion(result, 0, scores.size(), scores.data());
+    return result;
+}
+
+JNIEXPORT void JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNRerank_releaseNative(JNIEnv *env, jobject thiz,
+                                                            jlong rerank_ptr) {
+    MNN_DEBUG("Java_io_kindbrave_mnn_server_engine_MNNRerank_releaseNative");
+    delete reinterpret_cast<mls::RerankSession *>(rerank_ptr);
+}
+
+}
@@ -0,0 +1,180 @@
+#include "rerank_session.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include "MNN/expr/ExecutorScope.hpp"
+#include "MNN/expr/ExprCreator.hpp"
+#include "mls_log.h"
+#include "include/trace/mls_trace.hpp"
+
+using namespace MNN;
+using namespace MNN::Express;
+
+namespace mls {
+
+static std::string BaseDir(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? "./" : path.substr(0, pos + 1);
+}
+
+RerankSession::RerankSession(std::string config_path, json extra_config):
+        config_path_(std::move(config_path)), extra_config_(std::move(extra_config)) {
+}
+
+RerankSession::~RerankSession() {
+    // modules must go before the runtime and executor that own their buffers
+    module_.reset();
+    runtime_manager_.reset();
+}
+
+bool RerankSession::Load() {
+    std::ifstream config_file(config_path_);
+    if (config_file.good()) {
+        config_ = json::parse(config_file, nullptr, false);
+    }
+    if (!config_.is_object()) {
+        config_ = json::object();
+    }
+    for (auto& item : extra_config_.items()) {
+        config_[item.key()] = item.value();
+    }
+    auto base_dir = BaseDir(config_path_);
+    max_length_ = config_.value("max_length", 512);
+    batch_size_ = std::max(1, config_.value("batch_size", 16));
+    cls_id_ = config_.value("cls_id", 101);
+    sep_id_ = config_.value("sep_id", 102);
+    pad_id_ = config_.value("pad_id", 0);
+    apply_sigmoid_ = config_.value("apply_sigmoid", true);
+    auto tokenizer_path = base_dir + config_.value("tokenizer_file", std::string("tokenizer.txt"));
+    tokenizer_.reset(MNN::Transformer::Tokenizer::createTokenizer(tokenizer_path));
+    if (!tokenizer_) {
+        MNN_ERROR("rerank tokenizer load failed: %s", tokenizer_path.c_str());
+        return false;
+    }
+
+    BackendConfig backend_config;
+    executor_ = Executor::newExecutor(MNN_FORWARD_CPU, backend_config, 1);
+    ExecutorScope scope(executor_);
+    ScheduleConfig schedule_config;
+    BackendConfig cpu_backend_config;
+    schedule_config.type = MNN_FORWARD_CPU;
+    schedule_config.numThread = config_.value("thread_num", 4);
+    cpu_backend_config.power = BackendConfig::Power_High;
+    cpu_backend_config.precision = config_.value("precision", std::string("low")) == "low" ?
+                                   BackendConfig::Precision_Low : BackendConfig::Precision_Normal;
+    schedule_config.backendConfig = &cpu_backend_config;
+    runtime_manager_.reset(Executor::RuntimeManager::createRuntimeManager(schedule_config));
+    runtime_manager_->setHint(MNN::Interpreter::MEM_ALLOCATOR_TYPE, 0);
+    runtime_manager_->setHint(MNN::Interpreter::DYNAMIC_QUANT_OPTIONS, 1);
+    Module::Config module_config;
+    module_config.shapeMutable = true;
+    module_config.rearrange = true;
+    std::vector<std::string> inputs {"input_ids", "attention_mask", "token_type_ids"};
+    std::vector<std::string> outputs {"logits"};
+    auto model_path = base_dir + config_.value("model", std::string("rerank.mnn"));
+    module_.reset(Module::load(inputs, outputs, model_path.c_str(), runtime_manager_, &module_config));
+    if (!module_) {
+        MNN_ERROR("rerank model load failed: %s", model_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::vector<int> RerankSession::Encode(const std::string& text) {
+    auto ids = tokenizer_->encode(text);
+    // the pair template adds its own [CLS] / [SEP]
+    if (!ids.empty() && ids.front() == cls_id_) {
+        ids.erase(ids.begin());
+    }
+    if (!ids.empty() && ids.back() == sep_id_) {
+        ids.pop_back();
+    }
+    return ids;
+}
+
+std::vector<float> RerankSession::Score(const std::string& query, const std::vector<std::string>& passages) {
+    if (!module_ || !tokenizer_) {
+        return {};
+    }
+    std::vector<float> scores(passages.size(), 0.0f);
+    if (passages.empty()) {
+        return scores;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ExecutorScope scope(executor_);
+    // [CLS] query [SEP] passage [SEP]; the query keeps at most half the length budget
+    std::vector<std::vector<int>> pairs(passages.size());
+    std::vector<int> type_starts(passages.size());
+    {
+        MLS_TRACE_SCOPE("rerank", "tokenize");
+        auto query_ids = Encode(query);
+        size_t query_len = std::min<size_t>(query_ids.size(), std::max(1, max_length_ / 2 - 2));
+        for (size_t i = 0; i < passages.size(); i++) {
+            auto passage_ids = Encode(passages[i]);
+            size_t passage_len = std::min<size_t>(passage_ids.size(), std::max<int>(0, max_length_ - 3 - static_cast<int>(query_len)));
+            auto& ids = pairs[i];
+            ids.reserve(query_len + passage_len + 3);
+            ids.push_back(cls_id_);
+            ids.insert(ids.end(), query_ids.begin(), query_ids.begin() + query_len);
+            ids.push_back(sep_id_);
+            type_starts[i] = static_cast<int>(ids.size());
+            ids.insert(ids.end(), passage_ids.begin(), passage_ids.begin() + passage_len);
+            ids.push_back(sep_id_);
+        }
+    }
+    // bucket by length so every batch pads to roughly its own size
+    std::vector<size_t> order(passages.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&pairs](size_t a, size_t b) {
+        return pairs[a].size() < pairs[b].size();
+    });
+    MLS_TRACE_SCOPE("rerank", "forward");
+    for (size_t begin = 0; begin < order.size(); begin += batch_size_) {
+        size_t end = std::min(order.size(), begin + batch_size_);
+        std::vector<size_t> indices(order.begin() + begin, order.begin() + end);
+        if (!RunBatch(pairs, type_starts, indices, scores)) {
+            return {};
+        }
+    }
+    return scores;
+}
+
+bool RerankSession::RunBatch(const std::vector<std::vector<int>>& pairs, const std::vector<int>& type_starts,
+                             const std::vector<size_t>& indices, std::vector<float>& scores) {
+    int batch = static_cast<int>(indices.size());
+    int seq_len = static_cast<int>(pairs[indices.back()].size());
+    auto input_ids = _Input({batch, seq_len}, NCHW, halide_type_of<int>());
+    auto attention_mask = _Input({batch, seq_len}, NCHW, halide_type_of<int>());
+    auto token_type_ids = _Input({batch, seq_len}, NCHW, halide_type_of<int>());
+    auto ids_ptr = input_ids->writeMap<int>();
+    auto mask_ptr = attention_mask->writeMap<int>();
+    auto type_ptr = token_type_ids->writeMap<int>();
+    for (int b = 0; b < batch; b++) {
+        auto& ids = pairs[indices[b]];
+        int len = static_cast<int>(ids.size());
+        for (int t = 0; t < seq_len; t++) {
+            bool valid = t < len;
+            ids_ptr[b * seq_len + t] = valid ? ids[t] : pad_id_;
+            mask_ptr[b * seq_len + t] = valid ? 1 : 0;
+            type_ptr[b * seq_len + t] = valid && t >= type_starts[indices[b]] ? 1 : 0;
+        }
+    }
+    auto outputs = module_->onForward({input_ids, attention_mask, token_type_ids});
+    if (outputs.empty() || outputs[0] == nullptr) {
+        MNN_ERROR("rerank forward failed");
+        return false;
+    }
+    auto logits = outputs[0];
+    auto info = logits->getInfo();
+    int classes = info->size / batch;
+    auto logits_ptr = logits->readMap<float>();
+    for (int b = 0; b < batch; b++) {
+        // single-logit heads score directly; two-class heads use the "relevant" logit
+        float logit = logits_ptr[b * classes + classes - 1];
+        scores[indices[b]] = apply_sigmoid_ ? 1.0f / (1.0f + std::exp(-logit)) : logit;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "MNN/expr/Executor.hpp"
+#include "MNN/expr/Module.hpp"
+#include "include/asr/tokenizer.hpp"
+
+using nlohmann::json;
+
+namespace mls {
+
+// Cross-encoder reranker: scores (query, passage) pairs with a BERT-style classifier.
+// The model directory holds config.json, the exported module (inputs input_ids,
+// attention_mask, token_type_ids; output logits) and tokenizer.txt.
+class RerankSession {
+public:
+    RerankSession(std::string config_path, json extra_config);
+    ~RerankSession();
+    // false when the model or the tokenizer can't be loaded
+    bool Load();
+    // One score per passage, in the order given; empty when the forward pass fails.
+    std::vector<float> Score(const std::string& query, const std::vector<std::string>& passages);
+
+private:
+    std::vector<int> Encode(const std::string& text);
+    bool RunBatch(const std::vector<std::vector<int>>& pairs, const std::vector<int>& type_starts,
+                  const std::vector<size_t>& indices, std::vector<float>& scores);
+
+    std::string config_path_;
+    json extra_config_{};
+    json config_{};
+    int max_length_{512};
+    int batch_size_{16};
+    int cls_id_{101};
+    int sep_id_{102};
+    int pad_id_{0};
+    bool apply_sigmoid_{true};
+    std::shared_ptr<MNN::Express::Executor> executor_{nullptr};
+    std::shared_ptr<MNN::Express::Executor::RuntimeManager> runtime_manager_{nullptr};
+    std::unique_ptr<MNN::Express::Module> module_{nullptr};
+    std::unique_ptr<MNN::Transformer::Tokenizer> tokenizer_{nullptr};
+    std::mutex mutex_;
+};
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace mls {
+
+// Fixed-size worker pool for CPU-side batch work (tokenization, per-segment ASR).
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads) {
+        threads = std::max<size_t>(threads, 1);
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            workers_.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Size() const {
+        return workers_.size();
+    }
+
+    std::future<void> Submit(std::function<void()> task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged]() { (*packaged)(); });
+        }
+        cv_.notify_one();
+        return future;
+    }
+
+    // Runs fn(i) for every i in [0, n) and waits. The calling thread takes part and only
+    // waits for items already started elsewhere, so nested calls from workers can't deadlock.
+    // The first exception thrown by fn is rethrown once every started item has finished;
+    // items not yet started are skipped after it.
+    void ParallelFor(size_t n, std::function<void(size_t)> fn) {
+        if (n == 0) {
+            return;
+        }
+        struct State {
+            std::function<void(size_t)> fn;
+            size_t n;
+            std::atomic<size_t> next{0};
+            std::atomic<bool> failed{false};
+            size_t done = 0;
+            std::exception_ptr error;
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+        auto state = std::make_shared<State>();
+        state->fn = std::move(fn);
+        state->n = n;
+        auto run = [state]() {
+            size_t finished = 0;
+            for (size_t i = state->next++; i < state->n; i = state->next++) {
+                // every item counts as done, failed or skipped, so the wait below always ends
+                finished++;
+                if (state->failed) {
+                    continue;
+                }
+                try {
+                    state->fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (!state->error) {
+                        state->error = std::current_exception();
+                    }
+                    state->failed = true;
+                }
+            }
+            if (finished > 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done += finished;
+                if (state->done == state->n) {
+                    state->cv.notify_all();
+                }
+            }
+        };
+        size_t helper_count = std::min(n, workers_.size() + 1) - 1;
+        for (size_t i = 0; i < helper_count; i++) {
+            Submit(run);
+        }
+        run();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [&state]() { return state->done == state->n; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    // Runs fn(i, out) for every i in [0, n), where fn appends the output of item i to out, and
+    // concatenates the results in order: item i owns data[offsets[i], offsets[i + 1]). Items are
+    // split into one contiguous shard per thread, so buffers grow per shard rather than per item.
+    template <typename T>
+    void ParallelGather(size_t n, std::function<void(size_t, std::vector<T>&)> fn,
+                        std::vector<T>& data, std::vector<int>& offsets) {
+        offsets.assign(n + 1, 0);
+        data.clear();
+        size_t shard_count = std::min(n, workers_.size() + 1);
+        std::vector<std::vector<T>> shards(shard_count);
+        ParallelFor(shard_count, [&](size_t shard) {
+            auto& out = shards[shard];
+            for (size_t i = n * shard / shard_count; i < n * (shard + 1) / shard_count; i++) {
+                fn(i, out);
+                // shard-local end, rebased below
+                offsets[i + 1] = static_cast<int>(out.size());
+            }
+        });
+        size_t total = 0;
+        for (const auto& shard : shards) {
+            total += shard.size();
+        }
+        data.reserve(total);
+        for (size_t shard = 0; shard < shard_count; shard++) {
+            int base = static_cast<int>(data.size());
+            for (size_t i = n * shard / shard_count; i < n * (shard + 1) / shard_count; i++) {
+                offsets[i + 1] += base;
+            }
+            data.insert(data.end(), shards[shard].begin(), shards[shard].end());
+        }
+    }
+
+    // Process-wide pool with one worker per core.
+    static ThreadPool& Shared() {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+private:
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+                if (stop_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace mls {
+
+// Records one timestamp per emitted token of a single response. The buffer is
+// preallocated for max_new_tokens so Mark() never allocates inside the decode loop.
+class TokenTimingTrace {
+public:
+    struct Summary {
+        int64_t ttft_us = 0;
+        int64_t itl_p50_us = 0;
+        int64_t itl_p90_us = 0;
+        int64_t itl_p99_us = 0;
+        int64_t itl_max_us = 0;
+        int64_t stall_count = 0;
+        int64_t token_count = 0;
+    };
+
+    void Begin(size_t capacity) {
+        timestamps_us_.clear();
+        if (timestamps_us_.capacity() < capacity) {
+            timestamps_us_.reserve(capacity);
+        }
+        begin_ = Clock::now();
+    }
+
+    void Mark() {
+        if (timestamps_us_.size() < timestamps_us_.capacity()) {
+            timestamps_us_.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin_).count());
+        }
+    }
+
+    Summary Summarize(int64_t stall_threshold_us) const {
+        Summary summary;
+        summary.token_count = static_cast<int64_t>(timestamps_us_.size());
+        if (timestamps_us_.empty()) {
+            return summary;
+        }
+        summary.ttft_us = timestamps_us_[0];
+        std::vector<int64_t> intervals;
+        intervals.reserve(timestamps_us_.size());
+        for (size_t i = 1; i < timestamps_us_.size(); i++) {
+            int64_t interval = timestamps_us_[i] - timestamps_us_[i - 1];
+            if (interval > stall_threshold_us) {
+                summary.stall_count++;
+            }
+            intervals.push_back(interval);
+        }
+        if (intervals.empty()) {
+            return summary;
+        }
+        std::sort(intervals.begin(), intervals.end());
+        summary.itl_p50_us = Percentile(intervals, 50);
+        summary.itl_p90_us = Percentile(intervals, 90);
+        summary.itl_p99_us = Percentile(intervals, 99);
+        summary.itl_max_us = intervals.back();
+        return summary;
+    }
+
+    // Writes the trace in Chrome trace-event format, viewable in chrome://tracing or Perfetto.
+    bool WriteChromeTrace(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out.good()) {
+            return false;
+        }
+        out << "{\"traceEvents\":[";
+        int64_t prev = 0;
+        for (size_t i = 0; i < timestamps_us_.size(); i++) {
+            if (i > 0) {
+                out << ",";
+            }
+            out << "{\"name\":\"" << (i == 0 ? "prefill" : "token") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+                << ",\"ts\":" << prev << ",\"dur\":" << (timestamps_us_[i] - prev)
+                << ",\"args\":{\"index\":" << i << "}}";
+            prev = timestamps_us_[i];
+        }
+        out << "]}";
+        return out.good();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static int64_t Percentile(const std::vector<int64_t>& sorted, int percent) {
+        size_t index = (sorted.size() - 1) * percent / 100;
+        return sorted[index];
+    }
+
+    Clock::time_point begin_{};
+    std::vector<int64_t> timestamps_us_{};
+};
+
+}
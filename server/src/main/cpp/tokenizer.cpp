@@ -6,16 +6,22 @@
 //
 
 #include "include/asr/tokenizer.hpp"
+#include "include/trace/mls_trace.hpp"
+#include "thread_pool.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <queue>
 #include <functional>
 #include <random>
-#include <codecvt>
-#include <regex>
-#include <set>
+#include <atomic>
 #include <climits>
 #include <cctype>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 namespace MNN {
     namespace Transformer {
 
@@ -81,8 +87,233 @@ namespace MNN {
             }
         }
 
+        // binary format: header, section table, then each section 8-byte aligned. Arrays are
+        // stored in native byte order; the file is a cache compiled on the device that reads it.
+        static const char BINARY_MAGIC[8] = {'M', 'N', 'N', 'T', 'O', 'K', 'B', '\0'};
+        static constexpr uint32_t BINARY_VERSION = 2;
+
+        struct BinaryHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t type;
+            uint32_t section_count;
+            uint32_t reserved;
+            // the text file this was compiled from, both 0 for a standalone conversion
+            uint64_t source_size;
+            int64_t source_mtime_ns;
+        };
+
+        static int64_t mtime_ns(const struct stat& st) {
+#if defined(__APPLE__)
+            return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+            return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+        }
+
+        struct BinarySectionEntry {
+            uint32_t id;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        static uint64_t align8(uint64_t offset) {
+            return (offset + 7) & ~static_cast<uint64_t>(7);
+        }
+
+        static const TokenizerSection* find_section(const TokenizerSections& sections, uint32_t id) {
+            for (const auto& section : sections) {
+                if (section.id == id) {
+                    return &section;
+                }
+            }
+            return nullptr;
+        }
+
+        static bool copy_section(const TokenizerSections& sections, uint32_t id, std::vector<int>& values) {
+            const auto* section = find_section(sections, id);
+            if (section == nullptr || section->size % sizeof(int) != 0) {
+                return false;
+            }
+            const int* data = static_cast<const int*>(section->data);
+            values.assign(data, data + section->size / sizeof(int));
+            return true;
+        }
+
+        void TokenTable::assign(const std::vector<std::string>& tokens) {
+            std::vector<uint32_t> offsets(tokens.size() + 1, 0);
+            std::vector<char> blob;
+            size_t total = 0;
+            for (const auto& token : tokens) {
+                total += token.size();
+            }
+            blob.reserve(total);
+            for (size_t i = 0; i < tokens.size(); i++) {
+                offsets[i] = static_cast<uint32_t>(blob.size());
+                blob.insert(blob.end(), tokens[i].begin(), tokens[i].end());
+            }
+            offsets[tokens.size()] = static_cast<uint32_t>(blob.size());
+            offsets_.assign(std::move(offsets));
+            blob_.assign(std::move(blob));
+        }
+
+        std::string TokenTable::get(int id) const {
+            return std::string(blob_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+        }
+
+        void TokenTable::save(uint32_t first_id, TokenizerSections& sections) const {
+            offsets_.save(first_id, sections);
+            blob_.save(first_id + 1, sections);
+        }
+
+        bool TokenTable::load(uint32_t first_id, const TokenizerSections& sections) {
+            if (!offsets_.borrow(find_section(sections, first_id)) ||
+                !blob_.borrow(find_section(sections, first_id + 1)) || offsets_.empty()) {
+                return false;
+            }
+            for (size_t i = 0; i + 1 < offsets_.size(); i++) {
+                if (offsets_[i] > offsets_[i + 1]) {
+                    return false;
+                }
+            }
+            return offsets_[offsets_.size() - 1] <= blob_.size();
+        }
+
+        Tokenizer* Tokenizer::create(int tokenizer_type) {
+            switch (tokenizer_type)
+            {
+                case SENTENCEPIECE:
+                    return new Sentencepiece();
+                case TIKTOIKEN:
+                    return new Tiktoken();
+                case BERT:
+                    return new BertTokenizer();
+                case HUGGINGFACE:
+                    return new HuggingfaceTokenizer();
+                default:
+                    return nullptr;
+            }
+        }
+
+        Tokenizer* Tokenizer::load_binary(const std::string& filename, const struct stat* source) {
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) {
+                return nullptr;
+            }
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(BinaryHeader))) {
+                ::close(fd);
+                return nullptr;
+            }
+            size_t size = static_cast<size_t>(st.st_size);
+            void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED) {
+                return nullptr;
+            }
+            std::shared_ptr<const void> mapping(ptr, [size](const void* p) {
+                ::munmap(const_cast<void*>(p), size);
+            });
+            const char* base = static_cast<const char*>(ptr);
+            BinaryHeader header;
+            ::memcpy(&header, base, sizeof(header));
+            if (::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 || header.version != BINARY_VERSION ||
+                sizeof(header) + static_cast<uint64_t>(header.section_count) * sizeof(BinarySectionEntry) > size) {
+                return nullptr;
+            }
+            // a cache compiled from another version of the text is stale, whatever its mtime
+            if (source != nullptr && (header.source_size != static_cast<uint64_t>(source->st_size) ||
+                                      header.source_mtime_ns != mtime_ns(*source))) {
+                return nullptr;
+            }
+            TokenizerSections sections(header.section_count);
+            for (uint32_t i = 0; i < header.section_count; i++) {
+                BinarySectionEntry entry;
+                ::memcpy(&entry, base + sizeof(header) + i * sizeof(entry), sizeof(entry));
+                if (entry.offset % 8 != 0 || entry.offset > size || entry.size > size - entry.offset) {
+                    printf("Failed: corrupt binary tokenizer: %s.\n", filename.c_str());
+                    return nullptr;
+                }
+                sections[i] = {entry.id, base + entry.offset, static_cast<size_t>(entry.size)};
+            }
+            std::unique_ptr<Tokenizer> tokenizer(create(header.type));
+            if (!tokenizer || !copy_section(sections, SPECIAL_TOKENS, tokenizer->special_tokens_) ||
+                !copy_section(sections, STOP_TOKENS, tokenizer->stop_tokens_) ||
+                !copy_section(sections, PREFIX_TOKENS, tokenizer->prefix_tokens_) ||
+                !tokenizer->load_sections(sections)) {
+                printf("Failed: corrupt binary tokenizer: %s.\n", filename.c_str());
+                return nullptr;
+            }
+            tokenizer->type_ = static_cast<int>(header.type);
+            tokenizer->source_size_ = header.source_size;
+            tokenizer->source_mtime_ns_ = header.source_mtime_ns;
+            tokenizer->mapping_ = std::move(mapping);
+            tokenizer->index_special_tokens();
+            return tokenizer.release();
+        }
+
+        bool Tokenizer::save_binary(const std::string& filename) const {
+            if (type_ < 0) {
+                return false;
+            }
+            TokenizerSections sections;
+            sections.push_back({SPECIAL_TOKENS, special_tokens_.data(), special_tokens_.size() * sizeof(int)});
+            sections.push_back({STOP_TOKENS, stop_tokens_.data(), stop_tokens_.size() * sizeof(int)});
+            sections.push_back({PREFIX_TOKENS, prefix_tokens_.data(), prefix_tokens_.size() * sizeof(int)});
+            SectionStorage storage;
+            save_sections(sections, storage);
+            BinaryHeader header;
+            ::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+            header.version = BINARY_VERSION;
+            header.type = static_cast<uint32_t>(type_);
+            header.section_count = static_cast<uint32_t>(sections.size());
+            header.reserved = 0;
+            header.source_size = source_size_;
+            header.source_mtime_ns = source_mtime_ns_;
+            std::vector<BinarySectionEntry> table(sections.size());
+            uint64_t offset = align8(sizeof(header) + table.size() * sizeof(BinarySectionEntry));
+            for (size_t i = 0; i < sections.size(); i++) {
+                table[i] = {sections[i].id, 0, offset, sections[i].size};
+                offset = align8(offset + sections[i].size);
+            }
+            // write beside the target and rename, so a concurrent load never maps a partial file
+            const std::string temp = filename + ".tmp";
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out.good()) {
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(BinarySectionEntry));
+            uint64_t position = sizeof(header) + table.size() * sizeof(BinarySectionEntry);
+            static const char padding[8] = {0};
+            for (size_t i = 0; i < sections.size(); i++) {
+                out.write(padding, table[i].offset - position);
+                out.write(static_cast<const char*>(sections[i].data), sections[i].size);
+                position = table[i].offset + sections[i].size;
+            }
+            out.close();
+            if (!out.good() || std::rename(temp.c_str(), filename.c_str()) != 0) {
+                std::remove(temp.c_str());
+                return false;
+            }
+            return true;
+        }
+
         Tokenizer* Tokenizer::createTokenizer(const std::string& filename) {
-            Tokenizer* tokenizer = nullptr;
+            // the file may itself be compiled; otherwise use filename + ".bin" if it was compiled
+            // from this exact text file, or if there is no text file next to it
+            Tokenizer* tokenizer = load_binary(filename, nullptr);
+            if (tokenizer) {
+                return tokenizer;
+            }
+            const std::string binary_file = filename + ".bin";
+            struct stat text_stat{};
+            bool has_text = ::stat(filename.c_str(), &text_stat) == 0;
+            tokenizer = load_binary(binary_file, has_text ? &text_stat : nullptr);
+            if (tokenizer) {
+                return tokenizer;
+            }
             // check file
             std::ifstream tok_file(filename);
             if (!tok_file.good()) {
@@ -102,39 +333,24 @@ namespace MNN {
             line_str >> tokenizer_type;
             printf("tokenizer_type = %d\n", tokenizer_type);
             // create tokenizer
-            switch (tokenizer_type)
-            {
-                case SENTENCEPIECE:
-                    tokenizer = new Sentencepiece();
-                    break;
-                case TIKTOIKEN:
-                    tokenizer = new Tiktoken();
-                    break;
-                case BERT:
-                    tokenizer = new BertTokenizer();
-                    break;
-                case HUGGINGFACE:
-                    tokenizer = new HuggingfaceTokenizer();
-                    break;
-                default:
-                    return tokenizer;
+            tokenizer = create(tokenizer_type);
+            if (tokenizer == nullptr) {
+                return tokenizer;
             }
+            tokenizer->type_ = tokenizer_type;
+            tokenizer->source_size_ = static_cast<uint64_t>(text_stat.st_size);
+            tokenizer->source_mtime_ns_ = mtime_ns(text_stat);
             // load special tokens
             tokenizer->load_special(tok_file);
             // load vocabs
             tokenizer->load_vocab(tok_file);
             tok_file.close();
+            tokenizer->index_special_tokens();
+            // best effort: a read-only model directory just keeps loading the text
+            tokenizer->save_binary(binary_file);
             return tokenizer;
         }
 
-        bool Tokenizer::is_stop(int token) {
-            return std::find(stop_tokens_.begin(), stop_tokens_.end(), token) != stop_tokens_.end();
-        }
-
-        bool Tokenizer::is_special(int token) {
-            return std::find(special_tokens_.begin(), special_tokens_.end(), token) != special_tokens_.end();
-        }
-
         void Tokenizer::load_special(std::ifstream& tok_file) {
             std::string line;
             std::getline(tok_file, line);
@@ -166,35 +382,155 @@ namespace MNN {
             }
         }
 
-        std::vector<int> Tokenizer::encode(const std::string& str) {
-            std::vector<int> ids = prefix_tokens_;
-            if (!special_tokens_.empty()) {
-                std::string text = str;
-                size_t start = 0;
-                for (size_t i = 0; i < text.length(); ++i) {
-                    for (auto special_id : special_tokens_) {
-                        const auto& token = decode(special_id);
-                        if (token.empty()) continue;
-                        if (i + token.length() <= text.length() && text.substr(i, token.length()) == token) {
-                            if (i > start) {
-                                encode(text.substr(start, i - start), ids);
-                            }
-                            ids.push_back(special_id);
-                            start = i + token.length();
-                            i = start - 1;
+        void Tokenizer::index_special_tokens() {
+            int size = vocab_size();
+            for (int id : special_tokens_) {
+                size = std::max(size, id + 1);
+            }
+            for (int id : stop_tokens_) {
+                size = std::max(size, id + 1);
+            }
+            token_flags_.assign(size, 0);
+            special_strings_.resize(special_tokens_.size());
+            for (size_t i = 0; i < special_tokens_.size(); i++) {
+                if (special_tokens_[i] >= 0) {
+                    token_flags_[special_tokens_[i]] |= SPECIAL_FLAG;
+                    special_strings_[i] = decode(special_tokens_[i]);
+                }
+            }
+            for (int id : stop_tokens_) {
+                if (id >= 0) {
+                    token_flags_[id] |= STOP_FLAG;
+                }
+            }
+            build_special_matcher();
+        }
+
+        void Tokenizer::build_special_matcher() {
+            special_nodes_.assign(1, SpecialNode());
+            for (size_t i = 0; i < special_tokens_.size(); i++) {
+                const int special_id = special_tokens_[i];
+                const auto& token = special_strings_[i];
+                if (token.empty()) continue;
+                int node = 0;
+                for (unsigned char c : token) {
+                    int child = -1;
+                    for (const auto& edge : special_nodes_[node].next) {
+                        if (edge.first == c) {
+                            child = edge.second;
                             break;
                         }
                     }
+                    if (child < 0) {
+                        child = static_cast<int>(special_nodes_.size());
+                        special_nodes_[node].next.emplace_back(c, child);
+                        special_nodes_.emplace_back();
+                        special_nodes_[child].depth = special_nodes_[node].depth + 1;
+                    }
+                    node = child;
                 }
-                if (start < text.length()) {
-                    encode(text.substr(start), ids);
+                // the first id listed for a string wins
+                if (special_nodes_[node].id < 0) {
+                    special_nodes_[node].id = special_id;
                 }
-            } else {
-                encode(str, ids);
             }
+            for (int c = 0; c < 256; c++) {
+                special_root_[c] = 0;
+            }
+            // breadth first, so fail targets are complete before their users
+            std::vector<int> queue;
+            for (const auto& edge : special_nodes_[0].next) {
+                special_root_[edge.first] = edge.second;
+                queue.push_back(edge.second);
+            }
+            for (size_t head = 0; head < queue.size(); head++) {
+                int node = queue[head];
+                auto& current = special_nodes_[node];
+                int fail = current.fail;
+                current.output = special_nodes_[fail].id >= 0 ? fail : special_nodes_[fail].output;
+                for (const auto& edge : current.next) {
+                    special_nodes_[edge.second].fail = special_step(fail, edge.first);
+                    queue.push_back(edge.second);
+                }
+            }
+        }
+
+        int Tokenizer::special_step(int state, unsigned char c) const {
+            while (state != 0) {
+                for (const auto& edge : special_nodes_[state].next) {
+                    if (edge.first == c) {
+                        return edge.second;
+                    }
+                }
+                state = special_nodes_[state].fail;
+            }
+            return special_root_[c];
+        }
+
+        std::vector<int> Tokenizer::encode(const std::string& str) {
+            MLS_TRACE_SCOPE("tokenizer", "tokenize");
+            std::vector<int> ids;
+            encode_append(str, ids);
             return ids;
         }
 
+        void Tokenizer::encode_batch(const std::vector<std::string>& texts, std::vector<int>& ids, std::vector<int>& offsets) {
+            MLS_TRACE_SCOPE("tokenizer", "tokenize_batch");
+            // the encode paths only read the vocab tables; their scratch is thread_local
+            mls::ThreadPool::Shared().ParallelGather<int>(texts.size(), [this, &texts](size_t i, std::vector<int>& out) {
+                encode_append(texts[i], out);
+            }, ids, offsets);
+        }
+
+        void Tokenizer::encode_append(const std::string& str, std::vector<int>& ids) {
+            ids.insert(ids.end(), prefix_tokens_.begin(), prefix_tokens_.end());
+            if (special_nodes_.size() <= 1) {
+                encode(str, ids);
+                return;
+            }
+            // leftmost-longest: a match is committed once no path still in progress can start
+            // at or before it
+            thread_local std::string segment;
+            auto flush = [&](size_t begin, size_t end) {
+                if (end > begin) {
+                    segment.assign(str.data() + begin, end - begin);
+                    encode(segment, ids);
+                }
+            };
+            size_t start = 0;
+            int state = 0;
+            int best_id = -1;
+            size_t best_start = 0, best_end = 0;
+            for (size_t i = 0; i < str.size(); i++) {
+                state = special_step(state, static_cast<unsigned char>(str[i]));
+                const auto& node = special_nodes_[state];
+                int match = node.id >= 0 ? state : node.output;
+                if (match > 0) {
+                    size_t match_start = i + 1 - special_nodes_[match].depth;
+                    if (best_id < 0 || match_start < best_start || (match_start == best_start && i + 1 > best_end)) {
+                        best_id = special_nodes_[match].id;
+                        best_start = match_start;
+                        best_end = i + 1;
+                    }
+                }
+                if (best_id >= 0 && i + 1 - node.depth > best_start) {
+                    flush(start, best_start);
+                    ids.push_back(best_id);
+                    start = best_end;
+                    // rescan what followed the match from the root
+                    i = best_end - 1;
+                    state = 0;
+                    best_id = -1;
+                }
+            }
+            if (best_id >= 0) {
+                flush(start, best_start);
+                ids.push_back(best_id);
+                start = best_end;
+            }
+            flush(start, str.size());
+        }
+
         bool Sentencepiece::load_vocab(std::ifstream& tok_file) {
             std::string line, token;
             std::getline(tok_file, line);
@@ -206,19 +542,62 @@ namespace MNN {
                 std::getline(tok_file, line);
                 std::istringstream line_str(line);
                 line_str >> token >> score >> type;
-                token = base64_decode(token);
-                auto piece_type = static_cast<PieceType>(type);
-                SentencePiece piece = {token, score, piece_type};
-                sentence_pieces_[index] = std::move(piece);
-                if (piece_type == PieceType::NORMAL) {
-                    pieces_.insert({token, index});
-                } else {
-                    reserved_id_map_.insert({token, index});
-                    if (piece_type == PieceType::UNKNOWN) {
-                        unk_id_ = index;
-                    }
+                add_piece(index, base64_decode(token), score, static_cast<PieceType>(type));
+            }
+            return true;
+        }
+
+        void Sentencepiece::add_piece(int index, const std::string& token, float score, PieceType type) {
+            sentence_pieces_[index] = {token, score, type};
+            if (type == PieceType::NORMAL) {
+                pieces_.insert({token, index});
+            } else {
+                reserved_id_map_.insert({token, index});
+                if (type == PieceType::UNKNOWN) {
+                    unk_id_ = index;
                 }
             }
+        }
+
+        void Sentencepiece::save_sections(TokenizerSections& sections, SectionStorage& storage) const {
+            // the pieces are kept as structs, so flatten copies for the file
+            std::vector<std::string> tokens(sentence_pieces_.size());
+            auto scores = std::make_shared<std::vector<float>>(sentence_pieces_.size());
+            auto types = std::make_shared<std::vector<int>>(sentence_pieces_.size());
+            for (size_t i = 0; i < sentence_pieces_.size(); i++) {
+                tokens[i] = sentence_pieces_[i].piece;
+                (*scores)[i] = sentence_pieces_[i].score;
+                (*types)[i] = static_cast<int>(sentence_pieces_[i].type);
+            }
+            auto table = std::make_shared<TokenTable>();
+            table->assign(tokens);
+            table->save(TOKENS, sections);
+            sections.push_back({PIECE_SCORES, scores->data(), scores->size() * sizeof(float)});
+            sections.push_back({PIECE_TYPES, types->data(), types->size() * sizeof(int)});
+            storage.push_back(table);
+            storage.push_back(scores);
+            storage.push_back(types);
+        }
+
+        bool Sentencepiece::load_sections(const TokenizerSections& sections) {
+            // pieces are read without base64 decoding, but the lookup maps are still rebuilt
+            const auto* scores = find_section(sections, PIECE_SCORES);
+            const auto* types = find_section(sections, PIECE_TYPES);
+            TokenTable piece_table;
+            if (!piece_table.load(TOKENS, sections) || scores == nullptr || types == nullptr ||
+                scores->size != piece_table.size() * sizeof(float) || types->size != piece_table.size() * sizeof(int)) {
+                return false;
+            }
+            int vocab_len = piece_table.size();
+            sentence_pieces_.resize(vocab_len);
+            pieces_.reserve(vocab_len);
+            for (int index = 0; index < vocab_len; index++) {
+                float score;
+                int type;
+                ::memcpy(&score, static_cast<const char*>(scores->data) + index * sizeof(float), sizeof(float));
+                ::memcpy(&type, static_cast<const char*>(types->data) + index * sizeof(int), sizeof(int));
+                add_piece(index, piece_table.get(index), score, static_cast<PieceType>(type));
+            }
             return true;
         }
 
@@ -431,47 +810,174 @@ namespace MNN {
             return sentence_pieces_[id].type == PieceType::CONTROL;
         }
 
+        void ByteTrie::build(const std::vector<std::string>& keys) {
+            std::vector<int> order(keys.size());
+            for (size_t i = 0; i < keys.size(); i++) {
+                order[i] = static_cast<int>(i);
+            }
+            std::stable_sort(order.begin(), order.end(), [&keys](int a, int b) {
+                return keys[a] < keys[b];
+            });
+            std::vector<int> first_child(1, 0);
+            std::vector<int> child_count(1, 0);
+            std::vector<unsigned char> label(1, 0);
+            std::vector<int> value(1, -1);
+            // each entry is a node and the sorted key range [begin, end) below it; children
+            // are allocated together so they stay contiguous
+            struct Range {
+                int node;
+                size_t begin;
+                size_t end;
+                size_t depth;
+            };
+            std::vector<Range> queue{{0, 0, order.size(), 0}};
+            for (size_t head = 0; head < queue.size(); head++) {
+                Range range = queue[head];
+                size_t i = range.begin;
+                // keys ending here sort first, the lowest id first among equals
+                if (i < range.end && keys[order[i]].size() == range.depth) {
+                    value[range.node] = order[i];
+                    while (i < range.end && keys[order[i]].size() == range.depth) {
+                        i++;
+                    }
+                }
+                first_child[range.node] = static_cast<int>(value.size());
+                while (i < range.end) {
+                    unsigned char c = keys[order[i]][range.depth];
+                    size_t j = i;
+                    while (j < range.end && static_cast<unsigned char>(keys[order[j]][range.depth]) == c) {
+                        j++;
+                    }
+                    int node = static_cast<int>(value.size());
+                    first_child.push_back(0);
+                    child_count.push_back(0);
+                    label.push_back(c);
+                    value.push_back(-1);
+                    child_count[range.node]++;
+                    queue.push_back({node, i, j, range.depth + 1});
+                    i = j;
+                }
+            }
+            first_child_.assign(std::move(first_child));
+            child_count_.assign(std::move(child_count));
+            label_.assign(std::move(label));
+            value_.assign(std::move(value));
+            index_root();
+        }
+
+        void ByteTrie::save(uint32_t first_id, TokenizerSections& sections) const {
+            first_child_.save(first_id, sections);
+            child_count_.save(first_id + 1, sections);
+            label_.save(first_id + 2, sections);
+            value_.save(first_id + 3, sections);
+        }
+
+        bool ByteTrie::load(uint32_t first_id, const TokenizerSections& sections) {
+            if (!first_child_.borrow(find_section(sections, first_id)) ||
+                !child_count_.borrow(find_section(sections, first_id + 1)) ||
+                !label_.borrow(find_section(sections, first_id + 2)) ||
+                !value_.borrow(find_section(sections, first_id + 3))) {
+                return false;
+            }
+            size_t count = value_.size();
+            if (count == 0 || first_child_.size() != count || child_count_.size() != count || label_.size() != count) {
+                return false;
+            }
+            // walks trust the child ranges, so check them once here
+            for (size_t node = 0; node < count; node++) {
+                if (first_child_[node] < 0 || child_count_[node] < 0 ||
+                    static_cast<size_t>(first_child_[node]) + child_count_[node] > count) {
+                    return false;
+                }
+            }
+            index_root();
+            return true;
+        }
+
+        void ByteTrie::index_root() {
+            for (int c = 0; c < 256; c++) {
+                root_[c] = -1;
+            }
+            for (int k = 0; k < child_count_[0]; k++) {
+                root_[label_[first_child_[0] + k]] = first_child_[0] + k;
+            }
+        }
+
+        int ByteTrie::child(int node, unsigned char c) const {
+            if (node == 0) {
+                return root_[c];
+            }
+            int lo = first_child_[node];
+            int hi = lo + child_count_[node];
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (label_[mid] < c) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo < first_child_[node] + child_count_[node] && label_[lo] == c ? lo : -1;
+        }
+
+        int ByteTrie::walk(int node, const char* key, size_t size) const {
+            for (size_t i = 0; i < size && node >= 0; i++) {
+                node = child(node, static_cast<unsigned char>(key[i]));
+            }
+            return node;
+        }
+
+        int ByteTrie::longest_prefix(const char* data, size_t size, size_t* length, int node) const {
+            int id = -1;
+            for (size_t i = 0; i < size; i++) {
+                node = child(node, static_cast<unsigned char>(data[i]));
+                if (node < 0) {
+                    break;
+                }
+                if (value_[node] >= 0) {
+                    id = value_[node];
+                    *length = i + 1;
+                }
+            }
+            return id;
+        }
+
         bool Tiktoken::load_vocab(std::ifstream& tok_file) {
             std::string line;
             std::getline(tok_file, line);
             int vocab_len = std::stoi(line);
             // load vocab
-            decoder_.resize(vocab_len);
+            std::vector<std::string> tokens(vocab_len);
             for (int i = 0; i < vocab_len; i++) {
                 std::getline(tok_file, line);
-                auto token = base64_decode(line);
-                encoder_.insert({token, i});
-                decoder_[i] = token;
+                tokens[i] = base64_decode(line);
             }
+            trie_.build(tokens);
+            decoder_.assign(tokens);
             return true;
         }
 
+        void Tiktoken::save_sections(TokenizerSections& sections, SectionStorage& /*storage*/) const {
+            decoder_.save(TOKENS, sections);
+            trie_.save(TRIE, sections);
+        }
+
+        bool Tiktoken::load_sections(const TokenizerSections& sections) {
+            return decoder_.load(TOKENS, sections) && trie_.load(TRIE, sections);
+        }
+
         void Tiktoken::encode(const std::string& str, std::vector<int>& ids) {
             if (str.empty()) {
                 return;
             }
             size_t i = 0;
             while (i < str.size()) {
-                bool found_pair = false;
-                // Attempt to match the longest possible symbol
-                size_t longest_match_len = 0;
-                std::string longest_match;
-
-                // Check substrings of decreasing length
-                for (size_t len = str.size() - i; len > 0; --len) {
-                    std::string token = str.substr(i, len);
-                    auto it = encoder_.find(token);
-                    if (it != encoder_.end()) {
-                        if (len > longest_match_len) {
-                            longest_match_len = len;
-                            longest_match = it->first;
-                        }
-                    }
-                }
-
-                if (!longest_match.empty()) {
-                    ids.push_back(encoder_.at(longest_match));
-                    i += longest_match_len;
+                // greedy longest match, one trie walk
+                size_t length = 0;
+                int id = trie_.longest_prefix(str.data() + i, str.size() - i, &length);
+                if (id >= 0) {
+                    ids.push_back(id);
+                    i += length;
                 } else {
                     // If no matching symbol is found, this typically means an error in the encoding
                     // or the input text contains characters that the encoder doesn't know how to handle
@@ -482,42 +988,28 @@ namespace MNN {
         }
 
         std::string Tiktoken::decode(int id) {
-            if (id >= decoder_.size()) {
+            if (id < 0 || id >= decoder_.size()) {
                 return "";
             }
-            return decoder_[id];
+            return decoder_.get(id);
         }
 
         std::vector<int> BertTokenizer::word_piece(const std::string& token) {
-            auto it = encoder_.find(token);
-            if (it != encoder_.end()) {
-                return {it->second};
-            }
             std::vector<int> ids;
-            std::string current = token;
-            while (!current.empty()) {
-                int match_id = -1;
-                size_t match_pos = 0;
-                for (int len = current.size(); len > 0; --len) {
-                    std::string candidate = current.substr(0, len);
-                    if (!ids.empty()) {
-                        candidate = "##" + candidate;
-                    }
-                    auto it = encoder_.find(candidate);
-                    if (it != encoder_.end()) {
-                        match_id = it->second;
-                        match_pos = len;
-                        break;
-                    }
-                }
+            // pieces after the first continue from the "##" node
+            int continuation = trie_.walk(0, "##", 2);
+            size_t pos = 0;
+            while (pos < token.size()) {
+                int start = ids.empty() ? 0 : continuation;
+                size_t length = 0;
+                int match_id = start < 0 ? -1 : trie_.longest_prefix(token.data() + pos, token.size() - pos, &length, start);
                 // [UNK]
                 if (match_id == -1) {
                     ids.push_back(100);
                     break;
                 }
                 ids.push_back(match_id);
-                // not first word, adding ## prefix
-                current = current.substr(match_pos);
+                pos += length;
             }
             return ids;
         }
@@ -574,24 +1066,72 @@ namespace MNN {
             }
         }
 
-        std::wstring utf8_to_wstring(const std::string& str) {
-            std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-            return myconv.from_bytes(str);
+        // GPT-2 bytes_to_unicode: printable bytes map to themselves, the rest to 256 + n.
+        static int byte_to_unicode(int b) {
+            static const std::vector<int> table = []() {
+                std::vector<int> result(256);
+                int n = 0;
+                for (int c = 0; c < 256; c++) {
+                    bool printable = (c >= '!' && c <= '~') || (c >= 0xA1 && c <= 0xAC) || (c >= 0xAE && c <= 0xFF);
+                    result[c] = printable ? c : 256 + n++;
+                }
+                return result;
+            }();
+            return table[b];
         }
 
-        std::string wstring_to_utf8(const std::wstring& str) {
-            std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-            return myconv.to_bytes(str);
+        static void append_utf8(uint32_t cp, std::string& out) {
+            if (cp < 0x80) {
+                out.push_back(static_cast<char>(cp));
+            } else if (cp < 0x800) {
+                out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            } else {
+                out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+            }
         }
 
-// Given a token as a UTF8 string, encode each byte into an wchar_t
-        void byte_encode_token(const std::string& token,
-                               const std::unordered_map<uint8_t, wchar_t>& b2u,
-                               std::wstring* result) {
-            result->resize(0);
-            for (char c : token) {
-                wchar_t wc = b2u.at(uint8_t(c));
-                result->push_back(wc);
+        // Maps a vocab entry written in bytes_to_unicode symbols back to raw bytes.
+        static std::string unicode_to_bytes(const std::string& token, const int* unicode_to_byte) {
+            std::string bytes;
+            bytes.reserve(token.size());
+            for (size_t i = 0; i < token.size();) {
+                unsigned char c = static_cast<unsigned char>(token[i]);
+                uint32_t cp = c;
+                size_t len = one_char_len(token.data() + i);
+                if (len == 2 && i + 1 < token.size()) {
+                    cp = ((c & 0x1F) << 6) | (token[i + 1] & 0x3F);
+                } else if (len == 3 && i + 2 < token.size()) {
+                    cp = ((c & 0x0F) << 12) | ((token[i + 1] & 0x3F) << 6) | (token[i + 2] & 0x3F);
+                } else if (len == 4) {
+                    cp = 0xFFFFFFFF;
+                }
+                if (cp < 512 && unicode_to_byte[cp] >= 0) {
+                    bytes.push_back(static_cast<char>(unicode_to_byte[cp]));
+                }
+                i += len;
+            }
+            return bytes;
+        }
+
+        static uint64_t merge_key(int left, int right) {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(left)) << 32) | static_cast<uint32_t>(right);
+        }
+
+        static size_t merge_hash(uint64_t key) {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return static_cast<size_t>(key);
+        }
+
+        HuggingfaceTokenizer::HuggingfaceTokenizer() {
+            static std::atomic<uint64_t> next_instance{1};
+            instance_id_ = next_instance++;
+            for (int b = 0; b < 256; b++) {
+                byte_ids_[b] = -1;
             }
         }
 
@@ -602,153 +1142,252 @@ namespace MNN {
             std::getline(tok_file, line);
             std::istringstream line_str(line);
             line_str >> vocab_len >> merge_len;
-            // load vocab
-            decoder_.resize(vocab_len);
+            int unicode_to_byte[512];
+            std::fill(unicode_to_byte, unicode_to_byte + 512, -1);
+            for (int b = 0; b < 256; b++) {
+                unicode_to_byte[byte_to_unicode(b)] = b;
+            }
+            // load vocab; the symbol strings are only needed to resolve the merges
+            std::unordered_map<std::string, int> encoder;
+            encoder.reserve(vocab_len);
+            std::vector<std::string> decoded(vocab_len);
             for (int i = 0; i < vocab_len; i++) {
                 std::getline(tok_file, line);
-                encoder_.insert({line, i});
-                decoder_[i] = line;
+                decoded[i] = unicode_to_bytes(line, unicode_to_byte);
+                encoder.emplace(std::move(line), i);
+            }
+            decoded_.assign(decoded);
+            std::string symbol;
+            for (int b = 0; b < 256; b++) {
+                symbol.clear();
+                append_utf8(byte_to_unicode(b), symbol);
+                auto it = encoder.find(symbol);
+                byte_ids_[b] = it != encoder.end() ? it->second : -1;
+            }
+            // load merge_rule into a power-of-two table at most half full
+            size_t capacity = 16;
+            while (capacity < static_cast<size_t>(merge_len) * 2) {
+                capacity <<= 1;
             }
-            // load merge_rule
+            std::vector<Merge> merges(capacity);
+            merge_mask_ = capacity - 1;
             for (int i = 0; i < merge_len; i++) {
                 std::getline(tok_file, line);
-                int d = line.find(" ");
-                bpe_ranks_.insert({{utf8_to_wstring(line.substr(0, d)),
-                                    utf8_to_wstring(line.substr(d + 1))}, i});
-            }
-            // bytes_to_unicode
-            auto _insert_range = [=](int start, int end) {
-                for (int c = start; c <= end; c++) {
-                    b2u_.insert({uint8_t(c), wchar_t(c)});
+                size_t d = line.find(' ');
+                if (d == std::string::npos) {
+                    continue;
                 }
-            };
-
-            b2u_.clear();
-            _insert_range(L'!', L'~');
-            _insert_range(L'¡', L'¬');
-            _insert_range(L'®', L'ÿ');
-
-            int n = 0;
-            for (int b = 0; b < 256; b++) {
-                if (b2u_.find(uint8_t(b)) == b2u_.end()) {
-                    b2u_.insert({uint8_t(b), wchar_t(256 + n)});
-                    n++;
+                auto left = encoder.find(line.substr(0, d));
+                auto right = encoder.find(line.substr(d + 1));
+                line.erase(d, 1);
+                auto merged = encoder.find(line);
+                if (left == encoder.end() || right == encoder.end() || merged == encoder.end()) {
+                    continue;
+                }
+                uint64_t key = merge_key(left->second, right->second);
+                size_t slot = merge_hash(key) & merge_mask_;
+                while (merges[slot].merged >= 0 && merges[slot].key != key) {
+                    slot = (slot + 1) & merge_mask_;
+                }
+                // the first rule for a pair has the best rank
+                if (merges[slot].merged < 0) {
+                    merges[slot] = {key, i, merged->second};
                 }
             }
-            for (auto e : b2u_) {
-                u2b_.insert({e.second, e.first});
-            }
+            merges_.assign(std::move(merges));
             return true;
         }
 
-        void get_pairs(const std::wstring& word, std::vector<std::pair<std::wstring, std::wstring>>* pairs) {
-            pairs->clear();
+        void HuggingfaceTokenizer::save_sections(TokenizerSections& sections, SectionStorage& /*storage*/) const {
+            decoded_.save(TOKENS, sections);
+            merges_.save(BPE_MERGES, sections);
+            sections.push_back({BPE_BYTE_IDS, byte_ids_, sizeof(byte_ids_)});
+        }
 
-            if (word.size() < 2) return;
+        bool HuggingfaceTokenizer::load_sections(const TokenizerSections& sections) {
+            const auto* byte_ids = find_section(sections, BPE_BYTE_IDS);
+            if (!decoded_.load(TOKENS, sections) || !merges_.borrow(find_section(sections, BPE_MERGES)) ||
+                byte_ids == nullptr || byte_ids->size != sizeof(byte_ids_)) {
+                return false;
+            }
+            // the probe loop in find_merge needs a power-of-two table with a free slot
+            size_t capacity = merges_.size();
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+                return false;
+            }
+            merge_mask_ = capacity - 1;
+            bool has_free_slot = false;
+            for (size_t slot = 0; slot < capacity && !has_free_slot; slot++) {
+                has_free_slot = merges_[slot].merged < 0;
+            }
+            if (!has_free_slot) {
+                return false;
+            }
+            ::memcpy(byte_ids_, byte_ids->data, sizeof(byte_ids_));
+            return true;
+        }
 
-            wchar_t previous = word[0];
-            for (int i = 1; i < word.size(); i++) {
-                pairs->push_back({std::wstring(1, previous), std::wstring(1, word[i])});
-                previous = word[i];
+        bool HuggingfaceTokenizer::find_merge(int left, int right, const Merge** merge) const {
+            uint64_t key = merge_key(left, right);
+            size_t slot = merge_hash(key) & merge_mask_;
+            while (merges_[slot].merged >= 0) {
+                if (merges_[slot].key == key) {
+                    *merge = &merges_[slot];
+                    return true;
+                }
+                slot = (slot + 1) & merge_mask_;
             }
+            return false;
         }
 
-        void HuggingfaceTokenizer::bpe(const std::wstring& token, const BPERanks& bpe_ranks, std::vector<std::wstring>* result) {
-            std::set<int> merged;  // records indices in pairs that were merged.
-            auto _left = [](int i, std::set<int>& merged) {
-                for (int j = i - 1; j >= -1; j--) {
-                    if (merged.find(j) == merged.end()) return j;
+        // Merges the lowest-ranked adjacent pair until none is left, leftmost first on ties.
+        // Symbols form a linked list; the heap holds candidate pairs and stale entries are
+        // skipped when popped.
+        void HuggingfaceTokenizer::bpe(const char* data, size_t size, std::vector<int>& ids) const {
+            struct Candidate {
+                int rank;
+                int left;
+                int left_id;
+                int right_id;
+                bool operator<(const Candidate& other) const {
+                    // std heap is a max-heap: invert for lowest rank, then leftmost
+                    return rank != other.rank ? rank > other.rank : left > other.left;
                 }
-                return -1;
             };
-            auto _right = [](int i, int cap, std::set<int>& merged) {
-                for (int j = i + 1; j < cap; j++) {
-                    if (merged.find(j) == merged.end()) return j;
+            thread_local std::vector<int> symbols, prev, next;
+            thread_local std::vector<Candidate> heap;
+            int n = static_cast<int>(size);
+            symbols.resize(n);
+            prev.resize(n);
+            next.resize(n);
+            heap.clear();
+            for (int i = 0; i < n; i++) {
+                symbols[i] = byte_ids_[static_cast<unsigned char>(data[i])];
+                prev[i] = i - 1;
+                next[i] = i + 1 < n ? i + 1 : -1;
+            }
+            auto push_pair = [&](int left) {
+                int right = next[left];
+                const Merge* merge = nullptr;
+                if (left < 0 || right < 0 || symbols[left] < 0 || symbols[right] < 0 ||
+                    !find_merge(symbols[left], symbols[right], &merge)) {
+                    return;
                 }
-                return cap;
+                heap.push_back({merge->rank, left, symbols[left], symbols[right]});
+                std::push_heap(heap.begin(), heap.end());
             };
-
-            std::vector<std::pair<std::wstring, std::wstring>> pairs;
-            get_pairs(token, &pairs);
-
-            while (true) {
-                int min_score = INT_MAX;
-                int to_merge = -1;  // indices into pairs.
-
-                for (int i = 0; i < pairs.size(); ++i) {
-                    if (merged.find(i) == merged.end()) {  // pair i is not merged.
-                        auto iter = bpe_ranks.find(pairs[i]);
-                        int score = iter != bpe_ranks.end() ? iter->second : INT_MAX;
-                        if (score < min_score) {
-                            min_score = score;
-                            to_merge = i;
-                        }
-                    }
+            for (int i = 0; i + 1 < n; i++) {
+                push_pair(i);
+            }
+            while (!heap.empty()) {
+                std::pop_heap(heap.begin(), heap.end());
+                Candidate top = heap.back();
+                heap.pop_back();
+                int left = top.left;
+                int right = next[left];
+                // stale: one side was merged away or changed since this pair was queued
+                if (symbols[left] != top.left_id || right < 0 || symbols[right] != top.right_id) {
+                    continue;
                 }
+                const Merge* merge = nullptr;
+                find_merge(top.left_id, top.right_id, &merge);
+                symbols[left] = merge->merged;
+                symbols[right] = -1;
+                next[left] = next[right];
+                if (next[right] >= 0) {
+                    prev[next[right]] = left;
+                }
+                if (prev[left] >= 0) {
+                    push_pair(prev[left]);
+                }
+                push_pair(left);
+            }
+            for (int i = 0; i >= 0 && i < n; i = next[i]) {
+                if (symbols[i] >= 0) {
+                    ids.push_back(symbols[i]);
+                }
+            }
+        }
 
-                if (to_merge == -1) break;
-
-                merged.insert(to_merge);
-                std::wstring merge_into = pairs[to_merge].first + pairs[to_merge].second;
+        static inline bool is_space(unsigned char c) {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
 
-                int l = _left(to_merge, merged);
-                if (l >= 0) pairs[l].second = merge_into;
-                int r = _right(to_merge, pairs.size(), merged);
-                if (r < pairs.size()) pairs[r].first = merge_into;
-            }  // end while (true)
+        static inline bool is_alpha(unsigned char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
 
-            if (merged.size() == pairs.size()) {
-                result->push_back(token);
+        static inline bool is_digit(unsigned char c) {
+            return c >= '0' && c <= '9';
+        }
 
-            } else {
-                for (int i = 0; i < pairs.size(); ++i) {
-                    if (merged.find(i) == merged.end()) {
-                        if (_left(i, merged) < 0) result->push_back(pairs[i].first);
-                        result->push_back(pairs[i].second);
+        // Length of the pre-token at data: the GPT-2 pattern
+        // 's|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s\w]+|\s+ with ASCII classes,
+        // matched by hand instead of through std::regex.
+        static size_t pretoken_length(const char* data, size_t size) {
+            auto at = [&](size_t i) { return static_cast<unsigned char>(data[i]); };
+            if (at(0) == '\'') {
+                static const char* contractions[] = {"'s", "'t", "'re", "'ve", "'m", "'ll", "'d"};
+                for (auto contraction : contractions) {
+                    size_t len = std::strlen(contraction);
+                    if (len <= size && std::memcmp(data, contraction, len) == 0) {
+                        return len;
                     }
                 }
             }
+            size_t start = at(0) == ' ' && size > 1 ? 1 : 0;
+            unsigned char c = at(start);
+            size_t end = start;
+            if (is_alpha(c)) {
+                while (end < size && is_alpha(at(end))) end++;
+            } else if (is_digit(c)) {
+                while (end < size && is_digit(at(end))) end++;
+            } else if (!is_space(c)) {
+                while (end < size && !is_space(at(end)) && !is_alpha(at(end)) && !is_digit(at(end))) end++;
+            } else {
+                end = 0;
+                while (end < size && is_space(at(end))) end++;
+            }
+            return end;
         }
 
         void HuggingfaceTokenizer::encode(const std::string& str, std::vector<int>& ids) {
-            std::regex re("('s|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\\s\\w]+|\\s+)");
-            std::string input = str;
-            std::vector<std::string> result;
-            std::string token;
-            std::smatch match;
-            while (std::regex_search(input, match, re)) {
-                token = match.str(0);
-                input = match.suffix().str();
-                std::wstring wtoken;
-                for (char c : token) {
-                    wtoken.push_back(b2u_.at(uint8_t(c)));
-                }
-
-                std::vector<std::wstring> bpe_tokens;
-                bpe(wtoken, bpe_ranks_, &bpe_tokens);
-
-                for (auto ws : bpe_tokens) {
-                    result.push_back(wstring_to_utf8(ws));
-                }
+            // recent words per thread; cleared when full or used by another tokenizer
+            struct WordCache {
+                uint64_t owner = 0;
+                std::unordered_map<std::string, std::vector<int>> words;
+                std::string key;
+            };
+            static constexpr size_t WORD_CACHE_SIZE = 8192;
+            thread_local WordCache cache;
+            if (cache.owner != instance_id_) {
+                cache.words.clear();
+                cache.owner = instance_id_;
             }
-            for (auto s : result) {
-                ids.push_back(encoder_.at(s));
+            size_t pos = 0;
+            while (pos < str.size()) {
+                size_t length = pretoken_length(str.data() + pos, str.size() - pos);
+                cache.key.assign(str.data() + pos, length);
+                auto it = cache.words.find(cache.key);
+                if (it != cache.words.end()) {
+                    ids.insert(ids.end(), it->second.begin(), it->second.end());
+                } else {
+                    size_t first = ids.size();
+                    bpe(str.data() + pos, length, ids);
+                    if (cache.words.size() >= WORD_CACHE_SIZE) {
+                        cache.words.clear();
+                    }
+                    cache.words.emplace(cache.key, std::vector<int>(ids.begin() + first, ids.end()));
+                }
+                pos += length;
             }
         }
 
         std::string HuggingfaceTokenizer::decode(int id) {
-            // printf("decode id = %d, %lu, %s#\n", id, decoder_.size(), decoder_.at(id).c_str());
-            if (id >= decoder_.size()) {
+            if (id < 0 || id >= decoded_.size()) {
                 return "";
             }
-            std::wstring w = utf8_to_wstring(decoder_.at(id));
-            std::string r;
-            for (wchar_t c : w) {
-                if (u2b_.find(c) != u2b_.end()) {
-                    r.push_back(char(u2b_.at(c)));
-                }
-            }
-            return r;
+            return decoded_.get(id);
         }
     }
 }
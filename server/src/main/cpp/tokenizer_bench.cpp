@@ -0,0 +1,191 @@
+//
+// Standalone tokenizer benchmark, built on the host without MNN:
+//   g++ -std=c++17 -O2 -DMLS_TRACE_ENABLED=0 -I. -pthread -o tokenizer_bench tokenizer_bench.cpp tokenizer.cpp
+//   ./tokenizer_bench [tokenizer.txt [corpus.txt]]
+// or configure with -DMLS_BUILD_BENCH=ON. Without arguments it writes a synthetic
+// tiktoken-style vocab (50k tokens, 200 special tokens, like the Qwen tokenizers) to /tmp.
+// Reports the load time from text and from the compiled .bin (the .bin next to the
+// tokenizer is deleted first), encode and encode_batch throughput over the corpus with
+// special tokens spliced in, and decode + is_special + is_stop per token.
+//
+
+#include "include/asr/tokenizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using MNN::Transformer::Tokenizer;
+
+static constexpr int REPEAT = 5;
+static constexpr int SYNTHETIC_VOCAB = 50000;
+static constexpr int SYNTHETIC_SPECIALS = 200;
+
+static double ElapsedMs(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// best of REPEAT runs, in milliseconds
+template <typename Fn>
+static double BestMs(Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < REPEAT; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, ElapsedMs(begin));
+    }
+    return best;
+}
+
+static std::string Base64(const std::string& input) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    size_t i = 0;
+    for (; i + 2 < input.size(); i += 3) {
+        uint32_t v = (uint8_t)input[i] << 16 | (uint8_t)input[i + 1] << 8 | (uint8_t)input[i + 2];
+        output += {table[v >> 18], table[(v >> 12) & 63], table[(v >> 6) & 63], table[v & 63]};
+    }
+    if (i + 1 == input.size()) {
+        uint32_t v = (uint8_t)input[i] << 16;
+        output += {table[v >> 18], table[(v >> 12) & 63], '=', '='};
+    } else if (i + 2 == input.size()) {
+        uint32_t v = (uint8_t)input[i] << 16 | (uint8_t)input[i + 1] << 8;
+        output += {table[v >> 18], table[(v >> 12) & 63], table[(v >> 6) & 63], '='};
+    }
+    return output;
+}
+
+// distinct lowercase words, the same list on every call
+static std::vector<std::string> Words(size_t count) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> length(2, 8);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::set<std::string> seen;
+    std::vector<std::string> words;
+    while (words.size() < count) {
+        std::string word;
+        for (int i = length(rng); i > 0; i--) {
+            word += static_cast<char>(letter(rng));
+        }
+        if (seen.insert(word).second) {
+            words.push_back(word);
+        }
+    }
+    return words;
+}
+
+// Tiktoken layout: the 256 bytes, then words with and without a leading space, then the
+// special tokens, the last two of which also stop generation.
+static std::string WriteSyntheticVocab() {
+    std::vector<std::string> tokens;
+    for (int c = 0; c < 256; c++) {
+        tokens.emplace_back(1, static_cast<char>(c));
+    }
+    for (auto& word : Words((SYNTHETIC_VOCAB - SYNTHETIC_SPECIALS - 256) / 2)) {
+        tokens.push_back(word);
+        tokens.push_back(" " + word);
+    }
+    int first_special = static_cast<int>(tokens.size());
+    for (int i = 0; i < SYNTHETIC_SPECIALS; i++) {
+        tokens.push_back("<|extra_" + std::to_string(i) + "|>");
+    }
+    std::string path = "/tmp/tokenizer_bench_vocab.txt";
+    std::ofstream out(path);
+    out << Tokenizer::MAGIC_NUMBER << " " << Tokenizer::TIKTOIKEN << "\n";
+    out << SYNTHETIC_SPECIALS << " 2 0\n";
+    for (int i = 0; i < SYNTHETIC_SPECIALS; i++) {
+        out << first_special + i << " ";
+    }
+    out << SYNTHETIC_VOCAB - 2 << " " << SYNTHETIC_VOCAB - 1 << "\n";
+    out << tokens.size() << "\n";
+    for (auto& token : tokens) {
+        out << Base64(token) << "\n";
+    }
+    return path;
+}
+
+// Plain text from the synthetic vocab's words, ~1 MB, with one special token every ~300 bytes.
+static std::string SyntheticCorpus(const std::vector<std::string>& specials) {
+    auto words = Words((SYNTHETIC_VOCAB - SYNTHETIC_SPECIALS - 256) / 2);
+    std::mt19937 rng(11);
+    std::string text;
+    while (text.size() < (1 << 20)) {
+        text += words[rng() % words.size()];
+        text += (rng() % 12 == 0) ? ". " : " ";
+        if (!specials.empty() && rng() % 50 == 0) {
+            text += specials[rng() % specials.size()];
+        }
+    }
+    return text;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : WriteSyntheticVocab();
+    std::remove((path + ".bin").c_str());
+    auto begin = std::chrono::steady_clock::now();
+    std::unique_ptr<Tokenizer> tokenizer(Tokenizer::createTokenizer(path));
+    double text_ms = ElapsedMs(begin);
+    if (!tokenizer) {
+        fprintf(stderr, "can't load %s\n", path.c_str());
+        return 1;
+    }
+    double binary_ms = BestMs([&]() {
+        std::unique_ptr<Tokenizer> compiled(Tokenizer::createTokenizer(path));
+    });
+    printf("load: text %.2f ms, binary %.2f ms\n", text_ms, binary_ms);
+
+    std::vector<std::string> specials;
+    for (int id = 0; id < tokenizer->vocab_size(); id++) {
+        if (tokenizer->is_special(id)) {
+            specials.push_back(tokenizer->decode(id));
+        }
+    }
+    std::string corpus;
+    if (argc > 2) {
+        std::ifstream file(argv[2]);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        corpus = buffer.str();
+    } else {
+        corpus = SyntheticCorpus(specials);
+    }
+    // documents of ~1 KB, the size encode_batch sees from chunked RAG input
+    std::vector<std::string> docs;
+    for (size_t pos = 0; pos < corpus.size(); pos += 1024) {
+        docs.push_back(corpus.substr(pos, 1024));
+    }
+    double mb = corpus.size() / 1e6;
+    std::vector<int> ids;
+    double encode_ms = BestMs([&]() {
+        ids.clear();
+        for (auto& doc : docs) {
+            auto doc_ids = tokenizer->encode(doc);
+            ids.insert(ids.end(), doc_ids.begin(), doc_ids.end());
+        }
+    });
+    std::vector<int> batch_ids, offsets;
+    double batch_ms = BestMs([&]() {
+        tokenizer->encode_batch(docs, batch_ids, offsets);
+    });
+    printf("encode: %zu docs, %.2f MB, %zu ids, %zu specials; serial %.1f MB/s, batch %.1f MB/s\n",
+           docs.size(), mb, ids.size(), specials.size(), mb / (encode_ms / 1e3), mb / (batch_ms / 1e3));
+
+    size_t flagged = 0, bytes = 0;
+    double decode_ms = BestMs([&]() {
+        flagged = 0;
+        bytes = 0;
+        for (int id : ids) {
+            flagged += tokenizer->is_special(id) + tokenizer->is_stop(id);
+            bytes += tokenizer->decode(id).size();
+        }
+    });
+    printf("decode + is_special + is_stop: %.1f ns/token (%zu flagged, %zu bytes)\n",
+           decode_ms * 1e6 / ids.size(), flagged, bytes);
+    return 0;
+}
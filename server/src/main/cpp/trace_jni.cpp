@@ -0,0 +1,31 @@
+#include <jni.h>
+#include <string>
+#include "mls_log.h"
+#include "include/trace/mls_trace.hpp"
+
+extern "C" {
+
+JNIEXPORT void JNICALL Java_io_kindbrave_mnn_server_engine_MNNTrace_setEnabledNative(
+        JNIEnv *env,
+        jobject thiz,
+        jboolean enabled) {
+    if (enabled) {
+        mls::trace::clear();
+    }
+    mls::trace::set_enabled(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL Java_io_kindbrave_mnn_server_engine_MNNTrace_dumpNative(
+        JNIEnv *env,
+        jobject thiz,
+        jstring outputPath) {
+    const char* output_path = env->GetStringUTFChars(outputPath, nullptr);
+    bool result = mls::trace::export_chrome_json(output_path);
+    if (!result) {
+        LOGE("failed to dump trace to %s", output_path);
+    }
+    env->ReleaseStringUTFChars(outputPath, output_path);
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+} // extern "C"
@@ -0,0 +1,63 @@
+//
+//  vad.cpp
+//
+
+#include "include/asr/vad.hpp"
+#include "vector_simd.h"
+#include <algorithm>
+#include <cmath>
+
+namespace MNN {
+    namespace Transformer {
+
+        Vad::Vad(const VadOptions& options) : options_(options) {
+            frame_samples_ = options.sample_rate / 1000 * options.frame_ms;
+            speech_frames_ = std::max(1, options.min_speech_ms / options.frame_ms);
+            silence_frames_ = std::max(1, options.min_silence_ms / options.frame_ms);
+            pad_frames_ = std::max(0, options.pad_ms / options.frame_ms);
+            reset();
+        }
+
+        void Vad::reset() {
+            noise_db_ = options_.min_energy_db - options_.threshold_db;
+            in_speech_ = false;
+            voiced_run_ = 0;
+            silent_run_ = 0;
+            frame_index_ = 0;
+            segment_start_ = 0;
+            segment_end_ = 0;
+        }
+
+        Vad::Event Vad::accept_frame(const float* frame) {
+            float power = mls::simd::DotF32(frame, frame, frame_samples_) / frame_samples_;
+            float energy_db = 10.f * std::log10(power + 1e-10f);
+            bool voiced = energy_db > std::max(noise_db_ + options_.threshold_db, options_.min_energy_db);
+            // fall fast, rise slowly; voiced frames pull the floor up even slower
+            float rate = energy_db < noise_db_ ? 0.3f : (voiced ? 0.001f : 0.02f);
+            noise_db_ += rate * (energy_db - noise_db_);
+
+            int64_t index = frame_index_++;
+            Event event = Event::NONE;
+            if (!in_speech_) {
+                voiced_run_ = voiced ? voiced_run_ + 1 : 0;
+                if (voiced_run_ >= speech_frames_) {
+                    in_speech_ = true;
+                    silent_run_ = 0;
+                    // never reach back into the previous segment
+                    segment_start_ = std::max(index + 1 - voiced_run_ - pad_frames_, segment_end_);
+                    event = Event::SPEECH_START;
+                }
+            } else {
+                silent_run_ = voiced ? 0 : silent_run_ + 1;
+                if (silent_run_ >= silence_frames_) {
+                    in_speech_ = false;
+                    voiced_run_ = 0;
+                    segment_end_ = std::min(index + 1 - silent_run_ + pad_frames_, index + 1);
+                    event = Event::SPEECH_END;
+                }
+            }
+            return event;
+        }
+
+    }
+}
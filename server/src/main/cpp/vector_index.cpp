@@ -0,0 +1,574 @@
+#include "vector_index.h"
+#include "embedding_postprocess.h"
+#include "vector_simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mls {
+
+static constexpr uint32_t INDEX_MAGIC = 0x5849564d; // "MVIX"
+static constexpr uint32_t INDEX_VERSION = 1;
+// RandomLevel stays below 40 even for m = 2, so a deeper file is corrupt
+static constexpr int32_t MAX_LEVEL = 64;
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t dim;
+    int32_t m;
+    int32_t ef_construction;
+    int32_t ef_search;
+    int32_t storage;
+    int32_t max_level;
+    int64_t entry_point;
+    uint64_t count;
+};
+
+VectorIndex::VectorIndex(const Options& options) : options_(options) {
+    options_.m = std::max(options_.m, 2);
+    options_.ef_construction = std::max(options_.ef_construction, options_.m);
+    options_.ef_search = std::max(options_.ef_search, 1);
+    level_mult_ = 1.0 / std::log(static_cast<double>(options_.m));
+}
+
+int VectorIndex::Dim() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_.dim;
+}
+
+size_t VectorIndex::Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_count_;
+}
+
+size_t VectorIndex::MaxLinks(int level) const {
+    return level == 0 ? options_.m * 2 : options_.m;
+}
+
+int VectorIndex::RandomLevel() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double r = uniform(rng_);
+    return static_cast<int>(-std::log(std::max(r, 1e-12)) * level_mult_);
+}
+
+void VectorIndex::Prepare(const float* vector, Query& query) const {
+    int dim = options_.dim;
+    query.vector.assign(vector, vector + dim);
+    L2Normalize(query.vector.data(), dim);
+    if (options_.storage == Storage::INT8) {
+        query.quantized.resize(dim);
+        query.scale = QuantizeInt8(query.vector.data(), dim, query.quantized.data());
+    }
+}
+
+float VectorIndex::Distance(const Query& query, uint32_t node) const {
+    size_t dim = options_.dim;
+    if (options_.storage == Storage::INT8) {
+        int32_t dot = simd::DotI8(query.quantized.data(), vectors_i8_.data() + node * dim, dim);
+        return 1.0f - dot * query.scale * scales_[node];
+    }
+    return 1.0f - simd::DotF32(query.vector.data(), vectors_f32_.data() + node * dim, dim);
+}
+
+float VectorIndex::NodeDistance(uint32_t a, uint32_t b) const {
+    size_t dim = options_.dim;
+    if (options_.storage == Storage::INT8) {
+        int32_t dot = simd::DotI8(vectors_i8_.data() + a * dim, vectors_i8_.data() + b * dim, dim);
+        return 1.0f - dot * scales_[a] * scales_[b];
+    }
+    return 1.0f - simd::DotF32(vectors_f32_.data() + a * dim, vectors_f32_.data() + b * dim, dim);
+}
+
+void VectorIndex::StoreVector(const Query& query) {
+    if (options_.storage == Storage::INT8) {
+        vectors_i8_.insert(vectors_i8_.end(), query.quantized.begin(), query.quantized.end());
+        scales_.push_back(query.scale);
+    } else {
+        vectors_f32_.insert(vectors_f32_.end(), query.vector.begin(), query.vector.end());
+    }
+}
+
+void VectorIndex::OverwriteVector(uint32_t node, const Query& query) {
+    size_t dim = options_.dim;
+    if (options_.storage == Storage::INT8) {
+        std::copy(query.quantized.begin(), query.quantized.end(), vectors_i8_.begin() + node * dim);
+        scales_[node] = query.scale;
+    } else {
+        std::copy(query.vector.begin(), query.vector.end(), vectors_f32_.begin() + node * dim);
+    }
+}
+
+std::vector<VectorIndex::Candidate> VectorIndex::SearchLayer(const Query& query, uint32_t entry, int ef, int level) const {
+    if (visited_.size() < ids_.size()) {
+        visited_.resize(ids_.size(), 0);
+    }
+    if (++visit_epoch_ == 0) {
+        std::fill(visited_.begin(), visited_.end(), 0);
+        visit_epoch_ = 1;
+    }
+    // candidates: closest first; results: farthest first, bounded by ef
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> results;
+    float entry_distance = Distance(query, entry);
+    candidates.emplace(entry_distance, entry);
+    results.emplace(entry_distance, entry);
+    visited_[entry] = visit_epoch_;
+    while (!candidates.empty()) {
+        auto current = candidates.top();
+        if (current.first > results.top().first && results.size() >= static_cast<size_t>(ef)) {
+            break;
+        }
+        candidates.pop();
+        for (auto neighbor : links_[current.second][level]) {
+            if (visited_[neighbor] == visit_epoch_) {
+                continue;
+            }
+            visited_[neighbor] = visit_epoch_;
+            float distance = Distance(query, neighbor);
+            if (results.size() < static_cast<size_t>(ef) || distance < results.top().first) {
+                candidates.emplace(distance, neighbor);
+                results.emplace(distance, neighbor);
+                if (results.size() > static_cast<size_t>(ef)) {
+                    results.pop();
+                }
+            }
+        }
+    }
+    std::vector<Candidate> output(results.size());
+    for (size_t i = output.size(); i > 0; i--) {
+        output[i - 1] = results.top();
+        results.pop();
+    }
+    return output;
+}
+
+std::vector<uint32_t> VectorIndex::SelectNeighbors(std::vector<Candidate>& candidates, size_t count) const {
+    // HNSW heuristic: keep a candidate only if it is closer to the base than to every
+    // neighbor kept so far, which spreads links across clusters.
+    std::sort(candidates.begin(), candidates.end());
+    std::vector<uint32_t> selected;
+    selected.reserve(count);
+    for (auto& candidate : candidates) {
+        if (selected.size() >= count) {
+            break;
+        }
+        bool keep = true;
+        for (auto other : selected) {
+            if (NodeDistance(candidate.second, other) < candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void VectorIndex::Shrink(uint32_t node, int level) {
+    auto& links = links_[node][level];
+    if (links.size() <= MaxLinks(level)) {
+        return;
+    }
+    std::vector<Candidate> candidates;
+    candidates.reserve(links.size());
+    for (auto neighbor : links) {
+        candidates.emplace_back(NodeDistance(node, neighbor), neighbor);
+    }
+    links = SelectNeighbors(candidates, MaxLinks(level));
+}
+
+// Connects node, whose vector is already stored, to its nearest neighbors on layers
+// [0, level], replacing the links it had. Links it already holds keep routing the search
+// while it runs, so this also re-homes an existing node after its vector changed.
+void VectorIndex::Link(uint32_t node, const Query& query, int level) {
+    auto current = static_cast<uint32_t>(entry_point_);
+    float current_distance = Distance(query, current);
+    for (int l = max_level_; l > level; l--) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto neighbor : links_[current][l]) {
+                float distance = Distance(query, neighbor);
+                if (distance < current_distance) {
+                    current_distance = distance;
+                    current = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+    for (int l = std::min(level, max_level_); l >= 0; l--) {
+        auto candidates = SearchLayer(query, current, options_.ef_construction, l);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [node](const Candidate& candidate) { return candidate.second == node; }),
+                         candidates.end());
+        if (candidates.empty()) {
+            links_[node][l].clear();
+            continue;
+        }
+        current = candidates.front().second;
+        auto neighbors = SelectNeighbors(candidates, options_.m);
+        links_[node][l] = neighbors;
+        for (auto neighbor : neighbors) {
+            auto& links = links_[neighbor][l];
+            if (std::find(links.begin(), links.end(), node) == links.end()) {
+                links.push_back(node);
+                Shrink(neighbor, l);
+            }
+        }
+    }
+}
+
+bool VectorIndex::Add(int64_t id, const float* vector, int dim) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (options_.dim == 0) {
+        options_.dim = dim;
+    }
+    if (dim != options_.dim || dim <= 0) {
+        return false;
+    }
+    Query query;
+    Prepare(vector, query);
+    auto existing = id_to_node_.find(id);
+    if (existing != id_to_node_.end()) {
+        // replace in place instead of leaving a tombstone and a second node behind
+        uint32_t node = existing->second;
+        OverwriteVector(node, query);
+        Link(node, query, static_cast<int>(links_[node].size()) - 1);
+        return true;
+    }
+    auto node = static_cast<uint32_t>(ids_.size());
+    int level = RandomLevel();
+    ids_.push_back(id);
+    deleted_.push_back(0);
+    links_.emplace_back(level + 1);
+    StoreVector(query);
+    id_to_node_[id] = node;
+    live_count_++;
+    if (entry_point_ < 0) {
+        entry_point_ = node;
+        max_level_ = level;
+        return true;
+    }
+    Link(node, query, level);
+    if (level > max_level_) {
+        entry_point_ = node;
+        max_level_ = level;
+    }
+    return true;
+}
+
+// Drops tombstoned nodes and renumbers the rest. A live node that linked to a tombstone
+// inherits that tombstone's live neighbors on the same layer, trimmed by the usual heuristic,
+// so the graph stays connected around the hole.
+void VectorIndex::Compact() {
+    size_t count = ids_.size();
+    if (live_count_ == count) {
+        return;
+    }
+    for (uint32_t node = 0; node < count; node++) {
+        if (deleted_[node]) {
+            continue;
+        }
+        for (size_t l = 0; l < links_[node].size(); l++) {
+            auto& links = links_[node][l];
+            if (std::none_of(links.begin(), links.end(), [this](uint32_t n) { return deleted_[n] != 0; })) {
+                continue;
+            }
+            std::vector<uint32_t> merged;
+            auto merge = [&merged, node](uint32_t n) {
+                if (n != node && std::find(merged.begin(), merged.end(), n) == merged.end()) {
+                    merged.push_back(n);
+                }
+            };
+            for (auto neighbor : links) {
+                if (!deleted_[neighbor]) {
+                    merge(neighbor);
+                    continue;
+                }
+                for (auto second : links_[neighbor][l]) {
+                    if (!deleted_[second]) {
+                        merge(second);
+                    }
+                }
+            }
+            std::vector<Candidate> candidates;
+            candidates.reserve(merged.size());
+            for (auto neighbor : merged) {
+                candidates.emplace_back(NodeDistance(node, neighbor), neighbor);
+            }
+            links = SelectNeighbors(candidates, MaxLinks(static_cast<int>(l)));
+        }
+    }
+    std::vector<uint32_t> remap(count, UINT32_MAX);
+    uint32_t live = 0;
+    for (uint32_t node = 0; node < count; node++) {
+        if (!deleted_[node]) {
+            remap[node] = live++;
+        }
+    }
+    // keep the entry point if it survived, otherwise promote the highest live node
+    int64_t entry = -1;
+    int max_level = -1;
+    if (entry_point_ >= 0 && !deleted_[entry_point_]) {
+        entry = remap[entry_point_];
+        max_level = max_level_;
+    }
+    size_t dim = options_.dim;
+    for (uint32_t node = 0; node < count; node++) {
+        uint32_t to = remap[node];
+        if (to == UINT32_MAX) {
+            continue;
+        }
+        for (auto& links : links_[node]) {
+            for (auto& neighbor : links) {
+                neighbor = remap[neighbor];
+            }
+        }
+        int level = static_cast<int>(links_[node].size()) - 1;
+        if (level > max_level) {
+            max_level = level;
+            entry = to;
+        }
+        if (to == node) {
+            continue;
+        }
+        ids_[to] = ids_[node];
+        links_[to] = std::move(links_[node]);
+        if (options_.storage == Storage::INT8) {
+            std::copy_n(vectors_i8_.begin() + node * dim, dim, vectors_i8_.begin() + to * dim);
+            scales_[to] = scales_[node];
+        } else {
+            std::copy_n(vectors_f32_.begin() + node * dim, dim, vectors_f32_.begin() + to * dim);
+        }
+    }
+    ids_.resize(live);
+    deleted_.assign(live, 0);
+    links_.resize(live);
+    if (options_.storage == Storage::INT8) {
+        vectors_i8_.resize(live * dim);
+        scales_.resize(live);
+    } else {
+        vectors_f32_.resize(live * dim);
+    }
+    id_to_node_.clear();
+    for (uint32_t node = 0; node < live; node++) {
+        id_to_node_[ids_[node]] = node;
+    }
+    entry_point_ = entry;
+    max_level_ = max_level;
+    visited_.clear();
+    visit_epoch_ = 0;
+}
+
+bool VectorIndex::RemoveLocked(int64_t id) {
+    auto it = id_to_node_.find(id);
+    if (it == id_to_node_.end()) {
+        return false;
+    }
+    deleted_[it->second] = 1;
+    id_to_node_.erase(it);
+    live_count_--;
+    return true;
+}
+
+bool VectorIndex::Remove(int64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return RemoveLocked(id);
+}
+
+std::vector<VectorIndex::Result> VectorIndex::Search(const float* query_vector, int dim, int k) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Result> output;
+    if (entry_point_ < 0 || dim != options_.dim || k <= 0) {
+        return output;
+    }
+    Query query;
+    Prepare(query_vector, query);
+    auto current = static_cast<uint32_t>(entry_point_);
+    float current_distance = Distance(query, current);
+    for (int l = max_level_; l > 0; l--) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto neighbor : links_[current][l]) {
+                float distance = Distance(query, neighbor);
+                if (distance < current_distance) {
+                    current_distance = distance;
+                    current = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+    // widen the beam by the tombstones so deleted nodes don't starve the top-k
+    size_t tombstones = ids_.size() - live_count_;
+    int ef = std::max(options_.ef_search, k) + static_cast<int>(std::min<size_t>(tombstones, options_.ef_search));
+    auto candidates = SearchLayer(query, current, ef, 0);
+    for (auto& candidate : candidates) {
+        if (deleted_[candidate.second]) {
+            continue;
+        }
+        output.push_back({ids_[candidate.second], 1.0f - candidate.first});
+        if (output.size() >= static_cast<size_t>(k)) {
+            break;
+        }
+    }
+    return output;
+}
+
+bool VectorIndex::Save(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Compact();
+    // write next to the target and rename, so a crash never leaves a torn index
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+        return false;
+    }
+    IndexHeader header{INDEX_MAGIC, INDEX_VERSION, options_.dim, options_.m, options_.ef_construction,
+                       options_.ef_search, static_cast<int32_t>(options_.storage), max_level_,
+                       entry_point_, ids_.size()};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(ids_.data()), ids_.size() * sizeof(int64_t));
+    out.write(reinterpret_cast<const char*>(deleted_.data()), deleted_.size());
+    if (options_.storage == Storage::INT8) {
+        out.write(reinterpret_cast<const char*>(scales_.data()), scales_.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(vectors_i8_.data()), vectors_i8_.size());
+    } else {
+        out.write(reinterpret_cast<const char*>(vectors_f32_.data()), vectors_f32_.size() * sizeof(float));
+    }
+    for (auto& levels : links_) {
+        auto level_count = static_cast<uint32_t>(levels.size());
+        out.write(reinterpret_cast<const char*>(&level_count), sizeof(level_count));
+        for (auto& links : levels) {
+            auto link_count = static_cast<uint32_t>(links.size());
+            out.write(reinterpret_cast<const char*>(&link_count), sizeof(link_count));
+            out.write(reinterpret_cast<const char*>(links.data()), links.size() * sizeof(uint32_t));
+        }
+    }
+    out.close();
+    if (!out.good()) {
+        return false;
+    }
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+std::unique_ptr<VectorIndex> VectorIndex::Load(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(IndexHeader))) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = st.st_size;
+    void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    const auto* begin = static_cast<const uint8_t*>(ptr);
+    const uint8_t* cursor = begin;
+    const uint8_t* end = begin + size;
+    auto read = [&cursor, end](void* dst, size_t bytes) {
+        if (static_cast<size_t>(end - cursor) < bytes) {
+            return false;
+        }
+        if (bytes > 0) {
+            ::memcpy(dst, cursor, bytes);
+        }
+        cursor += bytes;
+        return true;
+    };
+    std::unique_ptr<VectorIndex> index;
+    IndexHeader header{};
+    bool ok = read(&header, sizeof(header)) && header.magic == INDEX_MAGIC && header.version == INDEX_VERSION &&
+              header.dim > 0 && header.m > 0 && header.max_level >= -1 && header.max_level < MAX_LEVEL &&
+              (header.storage == static_cast<int32_t>(Storage::FLOAT32) ||
+               header.storage == static_cast<int32_t>(Storage::INT8));
+    if (ok) {
+        // every node takes at least its id, tombstone flag, vector and level count, so a count
+        // the file can't hold is rejected before anything is allocated for it
+        uint64_t vector_bytes = header.storage == static_cast<int32_t>(Storage::INT8)
+                                ? static_cast<uint64_t>(header.dim) + sizeof(float)
+                                : static_cast<uint64_t>(header.dim) * sizeof(float);
+        uint64_t node_bytes = sizeof(int64_t) + 1 + vector_bytes + sizeof(uint32_t);
+        ok = header.count <= static_cast<uint64_t>(end - cursor) / node_bytes &&
+             (header.count == 0 ? header.entry_point == -1 && header.max_level == -1
+                                : header.entry_point >= 0 && header.entry_point < static_cast<int64_t>(header.count));
+    }
+    if (ok) {
+        Options options;
+        options.dim = header.dim;
+        options.m = header.m;
+        options.ef_construction = header.ef_construction;
+        options.ef_search = header.ef_search;
+        options.storage = static_cast<Storage>(header.storage);
+        index.reset(new VectorIndex(options));
+        auto count = static_cast<size_t>(header.count);
+        size_t dim = header.dim;
+        index->entry_point_ = header.entry_point;
+        index->max_level_ = header.max_level;
+        index->ids_.resize(count);
+        index->deleted_.resize(count);
+        index->links_.resize(count);
+        ok = read(index->ids_.data(), count * sizeof(int64_t)) && read(index->deleted_.data(), count);
+        if (ok && options.storage == Storage::INT8) {
+            index->scales_.resize(count);
+            index->vectors_i8_.resize(count * dim);
+            ok = read(index->scales_.data(), count * sizeof(float)) && read(index->vectors_i8_.data(), count * dim);
+        } else if (ok) {
+            index->vectors_f32_.resize(count * dim);
+            ok = read(index->vectors_f32_.data(), count * dim * sizeof(float));
+        }
+        for (size_t node = 0; ok && node < count; node++) {
+            uint32_t level_count = 0;
+            // each level stores at least its link count
+            ok = read(&level_count, sizeof(level_count)) && level_count > 0 &&
+                 static_cast<int64_t>(level_count) <= static_cast<int64_t>(header.max_level) + 1 &&
+                 level_count <= static_cast<size_t>(end - cursor) / sizeof(uint32_t);
+            index->links_[node].resize(ok ? level_count : 0);
+            for (uint32_t l = 0; ok && l < level_count; l++) {
+                uint32_t link_count = 0;
+                ok = read(&link_count, sizeof(link_count)) && link_count <= index->MaxLinks(static_cast<int>(l));
+                auto& links = index->links_[node][l];
+                links.resize(ok ? link_count : 0);
+                ok = ok && read(links.data(), link_count * sizeof(uint32_t));
+            }
+        }
+        // neighbors must be nodes that exist on the same layer, and the entry point on the top one
+        for (size_t node = 0; ok && node < count; node++) {
+            auto& levels = index->links_[node];
+            for (size_t l = 0; ok && l < levels.size(); l++) {
+                ok = std::all_of(levels[l].begin(), levels[l].end(), [&index, count, l](uint32_t neighbor) {
+                    return neighbor < count && index->links_[neighbor].size() > l;
+                });
+            }
+        }
+        ok = ok && (count == 0 || static_cast<int64_t>(index->links_[index->entry_point_].size()) ==
+                                  static_cast<int64_t>(header.max_level) + 1);
+        for (size_t node = 0; ok && node < count; node++) {
+            if (!index->deleted_[node]) {
+                ok = index->id_to_node_.emplace(index->ids_[node], static_cast<uint32_t>(node)).second;
+                index->live_count_++;
+            }
+        }
+    }
+    ::munmap(ptr, size);
+    return ok ? std::move(index) : nullptr;
+}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mls {
+
+// HNSW index over cosine similarity. Vectors are L2-normalized on insert and kept either
+// as fp32 or as int8 with one scale per vector. Deletes leave a tombstone: the node stays
+// in the graph for routing but is never returned, until Save compacts it away.
+class VectorIndex {
+public:
+    enum class Storage {
+        FLOAT32 = 0,
+        INT8 = 1
+    };
+    struct Options {
+        // 0 takes the dim of the first inserted vector
+        int dim = 0;
+        int m = 16;
+        int ef_construction = 200;
+        int ef_search = 64;
+        Storage storage = Storage::FLOAT32;
+    };
+    struct Result {
+        int64_t id;
+        float score;
+    };
+
+    explicit VectorIndex(const Options& options);
+    // Inserts or replaces the vector stored under id.
+    bool Add(int64_t id, const float* vector, int dim);
+    bool Remove(int64_t id);
+    std::vector<Result> Search(const float* query, int dim, int k) const;
+    size_t Size() const;
+    int Dim() const;
+    // Compacts tombstones away, then writes the index atomically.
+    bool Save(const std::string& path);
+    // Reads a saved index into memory; the file is mapped only while it is copied and
+    // validated, so it can be replaced afterwards.
+    static std::unique_ptr<VectorIndex> Load(const std::string& path);
+
+private:
+    struct Query {
+        std::vector<float> vector;
+        std::vector<int8_t> quantized;
+        float scale = 0.0f;
+    };
+    using Candidate = std::pair<float, uint32_t>;
+
+    void Prepare(const float* vector, Query& query) const;
+    float Distance(const Query& query, uint32_t node) const;
+    float NodeDistance(uint32_t a, uint32_t b) const;
+    void StoreVector(const Query& query);
+    void OverwriteVector(uint32_t node, const Query& query);
+    int RandomLevel();
+    size_t MaxLinks(int level) const;
+    std::vector<Candidate> SearchLayer(const Query& query, uint32_t entry, int ef, int level) const;
+    std::vector<uint32_t> SelectNeighbors(std::vector<Candidate>& candidates, size_t count) const;
+    void Shrink(uint32_t node, int level);
+    void Link(uint32_t node, const Query& query, int level);
+    void Compact();
+    bool RemoveLocked(int64_t id);
+
+    Options options_;
+    double level_mult_;
+    std::mt19937 rng_{42};
+    int64_t entry_point_{-1};
+    int max_level_{-1};
+    size_t live_count_{0};
+    std::vector<int64_t> ids_;
+    std::vector<uint8_t> deleted_;
+    // links_[node][level] holds the neighbor list of node on that layer
+    std::vector<std::vector<std::vector<uint32_t>>> links_;
+    std::vector<float> vectors_f32_;
+    std::vector<int8_t> vectors_i8_;
+    std::vector<float> scales_;
+    std::unordered_map<int64_t, uint32_t> id_to_node_;
+    // visit marks for SearchLayer, reset by bumping the epoch instead of clearing
+    mutable std::vector<uint32_t> visited_;
+    mutable uint32_t visit_epoch_{0};
+    mutable std::mutex mutex_;
+};
+
+}
@@ -0,0 +1,162 @@
+#include <jni.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "mls_log.h"
+#include "embedding_session.h"
+#include "vector_index.h"
+
+static jlongArray ToResult(JNIEnv *env, const std::vector<mls::VectorIndex::Result>& results, jfloatArray scores) {
+    std::vector<jlong> ids(results.size());
+    std::vector<jfloat> values(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        ids[i] = results[i].id;
+        values[i] = results[i].score;
+    }
+    if (scores != nullptr) {
+        jsize count = std::min<jsize>(env->GetArrayLength(scores), static_cast<jsize>(values.size()));
+        env->SetFloatArrayRegion(scores, 0, count, values.data());
+    }
+    jlongArray result = env->NewLongArray(ids.size());
+    env->SetLongArrayRegion(result, 0, ids.size(), ids.data());
+    return result;
+}
+
+extern "C" {
+
+JNIEXPORT jlong JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_createNative(JNIEnv *env, jobject thiz,
+                                                                jint dim, jint m,
+                                                                jint ef_construction,
+                                                                jint ef_search,
+                                                                jboolean int8) {
+    mls::VectorIndex::Options options;
+    options.dim = dim;
+    options.m = m;
+    options.ef_construction = ef_construction;
+    options.ef_search = ef_search;
+    options.storage = int8 ? mls::VectorIndex::Storage::INT8 : mls::VectorIndex::Storage::FLOAT32;
+    return reinterpret_cast<jlong>(new mls::VectorIndex(options));
+}
+
+JNIEXPORT jlong JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_loadNative(JNIEnv *env, jobject thiz,
+                                                              jstring path) {
+    const char *path_cstr = env->GetStringUTFChars(path, nullptr);
+    auto index = mls::VectorIndex::Load(path_cstr);
+    if (!index) {
+        MNN_DEBUG("vector index load failed: %s", path_cstr);
+    }
+    env->ReleaseStringUTFChars(path, path_cstr);
+    return reinterpret_cast<jlong>(index.release());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_saveNative(JNIEnv *env, jobject thiz,
+                                                              jlong index_ptr, jstring path) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    if (!index) {
+        return JNI_FALSE;
+    }
+    const char *path_cstr = env->GetStringUTFChars(path, nullptr);
+    bool ok = index->Save(path_cstr);
+    env->ReleaseStringUTFChars(path, path_cstr);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_addNative(JNIEnv *env, jobject thiz,
+                                                             jlong index_ptr, jlong id,
+                                                             jfloatArray vector) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    if (!index) {
+        return JNI_FALSE;
+    }
+    jsize dim = env->GetArrayLength(vector);
+    jfloat *data = env->GetFloatArrayElements(vector, nullptr);
+    bool ok = index->Add(id, data, dim);
+    env->ReleaseFloatArrayElements(vector, data, JNI_ABORT);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// Embeds the text and inserts it without handing the vector to Kotlin.
+JNIEXPORT jboolean JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_addTextNative(JNIEnv *env, jobject thiz,
+                                                                 jlong index_ptr,
+                                                                 jlong embedding_ptr, jlong id,
+                                                                 jstring text) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(embedding_ptr);
+    if (!index || !embedding) {
+        return JNI_FALSE;
+    }
+    const char *text_cstr = env->GetStringUTFChars(text, nullptr);
+    auto vec = embedding->embedding(text_cstr);
+    env->ReleaseStringUTFChars(text, text_cstr);
+    if (vec.get() == nullptr) {
+        return JNI_FALSE;
+    }
+    bool ok = index->Add(id, vec->readMap<float>(), vec->getInfo()->size);
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_removeNative(JNIEnv *env, jobject thiz,
+                                                                jlong index_ptr, jlong id) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    return index && index->Remove(id) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_searchNative(JNIEnv *env, jobject thiz,
+                                                                jlong index_ptr,
+                                                                jfloatArray query, jint k,
+                                                                jfloatArray scores) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    if (!index) {
+        return nullptr;
+    }
+    jsize dim = env->GetArrayLength(query);
+    jfloat *data = env->GetFloatArrayElements(query, nullptr);
+    auto results = index->Search(data, dim, k);
+    env->ReleaseFloatArrayElements(query, data, JNI_ABORT);
+    return ToResult(env, results, scores);
+}
+
+// Embeds the query and searches in one call; ids come back ranked, scores are written
+// into the caller's array.
+JNIEXPORT jlongArray JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_searchTextNative(JNIEnv *env, jobject thiz,
+                                                                    jlong index_ptr,
+                                                                    jlong embedding_ptr,
+                                                                    jstring query, jint k,
+                                                                    jfloatArray scores) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    auto *embedding = reinterpret_cast<mls::EmbeddingSession *>(embedding_ptr);
+    if (!index || !embedding) {
+        return nullptr;
+    }
+    const char *query_cstr = env->GetStringUTFChars(query, nullptr);
+    auto vec = embedding->embedding(query_cstr);
+    env->ReleaseStringUTFChars(query, query_cstr);
+    if (vec.get() == nullptr) {
+        return nullptr;
+    }
+    auto results = index->Search(vec->readMap<float>(), vec->getInfo()->size, k);
+    return ToResult(env, results, scores);
+}
+
+JNIEXPORT jint JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_sizeNative(JNIEnv *env, jobject thiz,
+                                                              jlong index_ptr) {
+    auto *index = reinterpret_cast<mls::VectorIndex *>(index_ptr);
+    return index ? static_cast<jint>(index->Size()) : 0;
+}
+
+JNIEXPORT void JNICALL
+Java_io_kindbrave_mnn_server_engine_MNNVectorIndex_releaseNative(JNIEnv *env, jobject thiz,
+                                                                 jlong index_ptr) {
+    delete reinterpret_cast<mls::VectorIndex *>(index_ptr);
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace mls {
+namespace simd {
+
+inline float DotF32(const float* a, const float* b, size_t n) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(__ARM_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(__AVX2__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_hadd_ps(half, half);
+    half = _mm_hadd_ps(half, half);
+    sum = _mm_cvtss_f32(half);
+#endif
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// y += a * x
+inline void AxpyF32(float a, const float* x, float* y, size_t n) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    float32x4_t va = vdupq_n_f32(a);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(y + i, vfmaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+    }
+#elif defined(__AVX2__)
+    __m256 va = _mm256_set1_ps(a);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(va, _mm256_loadu_ps(x + i))));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+// y = a * x
+inline void ScaleF32(float a, const float* x, float* y, size_t n) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    float32x4_t va = vdupq_n_f32(a);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(y + i, vmulq_f32(va, vld1q_f32(x + i)));
+    }
+#elif defined(__AVX2__)
+    __m256 va = _mm256_set1_ps(a);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(va, _mm256_loadu_ps(x + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] = a * x[i];
+    }
+}
+
+// out = (x + shift) * scale
+inline void AddMulF32(const float* x, const float* shift, const float* scale, float* out, size_t n) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vaddq_f32(vld1q_f32(x + i), vld1q_f32(shift + i)), vld1q_f32(scale + i)));
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(shift + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(sum, _mm256_loadu_ps(scale + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = (x[i] + shift[i]) * scale[i];
+    }
+}
+
+inline int32_t DotI8(const int8_t* a, const int8_t* b, size_t n) {
+    size_t i = 0;
+    int32_t sum = 0;
+#if defined(__ARM_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        int16x8_t lo = vmull_s8(vget_low_s8(va), vget_low_s8(vb));
+        int16x8_t hi = vmull_high_s8(va, vb);
+        acc = vpadalq_s16(acc, lo);
+        acc = vpadalq_s16(acc, hi);
+    }
+    sum = vaddvq_s32(acc);
+#elif defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    half = _mm_hadd_epi32(half, half);
+    half = _mm_hadd_epi32(half, half);
+    sum = _mm_cvtsi128_si32(half);
+#endif
+    for (; i < n; i++) {
+        sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+    return sum;
+}
+
+}
+}
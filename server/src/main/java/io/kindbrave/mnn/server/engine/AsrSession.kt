@@ -1,6 +1,7 @@
 package io.kindbrave.mnn.server.engine
 
 import android.util.Log
+import com.google.gson.Gson
 import io.kindbrave.mnn.server.utils.FileUtils
 
 class AsrSession(
@@ -14,8 +15,9 @@ class AsrSession(
 
     @Volatile
     private var modelLoading = false
+    // recognitions and open streams; the native instance serves them concurrently
     @Volatile
-    private var generating = false
+    private var activeCount = 0
     @Volatile
     private var releaseRequeted = false
 
@@ -30,27 +32,69 @@ class AsrSession(
     }
 
     fun generate(wavFileTag: String, progressListener: MNNAsr.AsrCallback) {
-        synchronized(this) {
-            val wavFilePath = FileUtils.extractAudioPath(wavFileTag)
-            if (wavFilePath == null) {
-                return
-            }
-            generating = true
+        val wavFilePath = FileUtils.extractAudioPath(wavFileTag) ?: return
+        acquire()
+        try {
             MNNAsr.recognizeFromFileStreamNative(nativePtr, wavFilePath, progressListener)
-            generating = false
-            if (releaseRequeted) {
-                release()
-            }
+        } finally {
+            releaseActive()
+        }
+    }
+
+    fun recognize(wavFileTag: String): String {
+        val wavFilePath = FileUtils.extractAudioPath(wavFileTag) ?: return ""
+        acquire()
+        try {
+            return MNNAsr.recognizeFileNative(nativePtr, wavFilePath) ?: ""
+        } finally {
+            releaseActive()
+        }
+    }
+
+    /**
+     * [recognize] with per-segment text and token timestamps.
+     */
+    fun recognizeSegments(wavFileTag: String): List<AsrSegment> {
+        val wavFilePath = FileUtils.extractAudioPath(wavFileTag) ?: return emptyList()
+        acquire()
+        try {
+            val segments = MNNAsr.recognizeFileSegmentsNative(nativePtr, wavFilePath) ?: return emptyList()
+            return Gson().fromJson(segments, Array<AsrSegment>::class.java).toList()
+        } finally {
+            releaseActive()
+        }
+    }
+
+    /**
+     * Opens a push-based recognition stream. Streams run concurrently and share the loaded
+     * model; the session is kept alive until every stream is released.
+     */
+    fun createStream(): AsrStream {
+        acquire()
+        return AsrStream(MNNAsr.createStreamNative(nativePtr)) { releaseActive() }
+    }
+
+    private fun acquire() {
+        synchronized(this) {
+            activeCount++
+        }
+    }
+
+    private fun releaseActive() {
+        synchronized(this) {
+            activeCount--
+            // a pending release() is waiting on this monitor and finishes the job
+            (this as Object).notifyAll()
         }
     }
 
     fun release() {
         synchronized(this) {
-            if (!generating && !modelLoading) {
+            if (activeCount == 0 && !modelLoading) {
                 releaseInner()
             } else {
                 releaseRequeted = true
-                while (generating || modelLoading) {
+                while (activeCount > 0 || modelLoading) {
                     try {
                         (this as Object).wait()
                     } catch (e: InterruptedException) {
@@ -0,0 +1,89 @@
+package io.kindbrave.mnn.server.engine
+
+import com.google.gson.Gson
+import com.google.gson.annotations.SerializedName
+import java.io.Closeable
+import java.nio.ByteBuffer
+
+data class AsrToken(
+    val text: String,
+    @SerializedName("start_ms") val startMs: Long,
+    @SerializedName("end_ms") val endMs: Long,
+    val confidence: Float
+)
+
+data class AsrSegment(
+    @SerializedName("start_ms") val startMs: Long,
+    @SerializedName("end_ms") val endMs: Long,
+    val text: String,
+    val tokens: List<AsrToken>
+)
+
+/**
+ * One utterance recognized from pushed audio, see [AsrSession.createStream].
+ * Buffers passed to [acceptWaveform] must be direct. Close the stream when done: the
+ * session's release() waits for every open stream.
+ */
+class AsrStream internal constructor(
+    private var nativePtr: Long,
+    private val onRelease: () -> Unit
+) : Closeable {
+
+    /**
+     * Feeds byteSize bytes starting at the buffer's position; the position is not changed.
+     */
+    fun acceptWaveform(buffer: ByteBuffer, byteSize: Int = buffer.remaining(), pcm16: Boolean = false) {
+        require(buffer.isDirect) { "acceptWaveform needs a direct ByteBuffer" }
+        require(byteSize in 0..buffer.remaining()) { "byteSize exceeds the remaining bytes" }
+        MNNAsr.acceptWaveformNative(nativePtr, buffer, buffer.position(), byteSize, pcm16)
+    }
+
+    /**
+     * Domain terms (names, products) to favor while decoding this stream.
+     */
+    fun setHotwords(hotwords: List<String>, score: Float = 1.5f) {
+        MNNAsr.setHotwordsNative(nativePtr, hotwords.toTypedArray(), score)
+    }
+
+    fun getPartial(): String {
+        return MNNAsr.getPartialNative(nativePtr) ?: ""
+    }
+
+    /**
+     * Speech segments closed since the previous call; silence between them is skipped.
+     */
+    fun getSegments(): List<AsrSegment> {
+        val segments = MNNAsr.getSegmentsNative(nativePtr) ?: return emptyList()
+        return Gson().fromJson(segments, Array<AsrSegment>::class.java).toList()
+    }
+
+    /**
+     * Tokens decoded since the previous call, with their time span and confidence.
+     */
+    fun getTokens(): List<AsrToken> {
+        val tokens = MNNAsr.getTokensNative(nativePtr) ?: return emptyList()
+        return Gson().fromJson(tokens, Array<AsrToken>::class.java).toList()
+    }
+
+    fun finish(): String {
+        return MNNAsr.finalizeNative(nativePtr) ?: ""
+    }
+
+    fun release() {
+        synchronized(this) {
+            if (nativePtr != 0L) {
+                MNNAsr.releaseStreamNative(nativePtr)
+                nativePtr = 0
+                onRelease()
+            }
+        }
+    }
+
+    override fun close() {
+        release()
+    }
+
+    protected fun finalize() {
+        release()
+    }
+}
@@ -0,0 +1,16 @@
+package io.kindbrave.mnn.server.engine
+
+/**
+ * Order matches mls::EmbeddingQuantization.
+ */
+enum class EmbeddingQuantization {
+    FLOAT32,
+    INT8,
+    BINARY
+}
+
+data class EmbeddingOutputOptions(
+    val truncateDim: Int = 0,
+    val normalize: Boolean = false,
+    val quantization: EmbeddingQuantization = EmbeddingQuantization.FLOAT32
+)
@@ -39,8 +39,15 @@ class EmbeddingSession(
             File(rootCacheDir).mkdirs()
         }
 
+        val configDir = FileUtils.getModelConfigDir(modelId)
+        File(configDir).mkdirs()
+
         val configMap = HashMap<String, Any>().apply {
             put("mmap_dir", rootCacheDir ?: "")
+            // the on-disk tier is opt-in; the in-memory LRU is always on
+            if (extraConfig?.embeddingPersistentCache == true) {
+                put("embedding_cache_path", "$configDir/embedding_cache.bin")
+            }
         }
 
         Log.d(tag, "MNN_DEBUG load initNative")
@@ -120,7 +127,78 @@ class EmbeddingSession(
         return MNNEmbedding.embedding(nativePtr, text)
     }
 
+    fun embeddingBatch(texts: List<String>): List<FloatArray> {
+        if (texts.isEmpty()) {
+            return emptyList()
+        }
+        val flat = MNNEmbedding.embeddingBatch(nativePtr, texts.toTypedArray())
+            ?: throw Exception("Failed to embed batch of ${texts.size} texts")
+        val dim = flat.size / texts.size
+        return List(texts.size) { i -> flat.copyOfRange(i * dim, (i + 1) * dim) }
+    }
+
+    fun embeddingEncoded(text: String, options: EmbeddingOutputOptions): ByteArray {
+        return MNNEmbedding.embeddingEncoded(
+            nativePtr,
+            text,
+            options.truncateDim,
+            options.normalize,
+            options.quantization.ordinal
+        ) ?: throw Exception("Failed to embed text")
+    }
+
+    fun embeddingBatchEncoded(texts: List<String>, options: EmbeddingOutputOptions): List<ByteArray> {
+        if (texts.isEmpty()) {
+            return emptyList()
+        }
+        val flat = MNNEmbedding.embeddingBatchEncoded(
+            nativePtr,
+            texts.toTypedArray(),
+            options.truncateDim,
+            options.normalize,
+            options.quantization.ordinal
+        ) ?: throw Exception("Failed to embed batch of ${texts.size} texts")
+        val rowBytes = flat.size / texts.size
+        return List(texts.size) { i -> flat.copyOfRange(i * rowBytes, (i + 1) * rowBytes) }
+    }
+
+    fun countTokens(texts: List<String>): IntArray {
+        return MNNEmbedding.countTokens(nativePtr, texts.toTypedArray())
+    }
+
+    /**
+     * Token ids of every text; [TokenBatch.ids] is one flat buffer indexed by [TokenBatch.offsets].
+     */
+    fun encodeBatch(texts: List<String>): TokenBatch {
+        val offsets = IntArray(texts.size + 1)
+        val ids = MNNEmbedding.encodeBatch(nativePtr, texts.toTypedArray(), offsets)
+        return TokenBatch(ids, offsets)
+    }
+
+    fun chunkByTokens(text: String, maxTokens: Int, overlap: Int = 0): List<String> {
+        val offsets = MNNEmbedding.chunkByTokens(nativePtr, text, maxTokens, overlap)
+        val bytes = text.toByteArray(Charsets.UTF_8)
+        return List(offsets.size / 2) { i ->
+            String(bytes, offsets[2 * i], offsets[2 * i + 1] - offsets[2 * i], Charsets.UTF_8)
+        }
+    }
+
+    internal fun nativeHandle(): Long {
+        return nativePtr
+    }
+
+    fun cacheStats(): LongArray {
+        return MNNEmbedding.cacheStatsNative(nativePtr)
+    }
+
     protected fun finalize() {
         release()
     }
-}
\ No newline at end of file
+}
+
+class TokenBatch(val ids: IntArray, val offsets: IntArray) {
+    val size: Int
+        get() = offsets.size - 1
+
+    operator fun get(index: Int): IntArray = ids.copyOfRange(offsets[index], offsets[index + 1])
+}
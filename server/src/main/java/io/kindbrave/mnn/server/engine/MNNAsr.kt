@@ -1,5 +1,7 @@
 package io.kindbrave.mnn.server.engine
 
+import java.nio.ByteBuffer
+
 object MNNAsr {
     external fun initNative(configPath: String): Long
 
@@ -8,11 +10,66 @@ object MNNAsr {
         wavFilePath: String,
         callback: AsrCallback
     )
+    /**
+     * Recognizes a whole file at once: speech segments are decoded in parallel, so this is
+     * faster than the streaming path when no partial results are needed.
+     */
+    external fun recognizeFileNative(asrPtr: Long, wavFilePath: String): String?
+
+    /**
+     * [recognizeFileNative] returning the speech segments with token timestamps and
+     * confidences, as a JSON array of [AsrSegment].
+     */
+    external fun recognizeFileSegmentsNative(asrPtr: Long, wavFilePath: String): String?
+
     external fun releaseNative(asrPtr: Long)
 
+    external fun createStreamNative(asrPtr: Long): Long
+
+    /**
+     * Feeds byteSize bytes of mono 16 kHz audio from a direct buffer: native-order float32
+     * samples in [-1, 1], or 16-bit PCM when pcm16 is set.
+     */
+    external fun acceptWaveformNative(streamPtr: Long, buffer: ByteBuffer, byteOffset: Int, byteSize: Int, pcm16: Boolean)
+
+    /**
+     * Biases decoding toward the given words or phrases by adding score to the logits of
+     * tokens that continue one of them. An empty array turns biasing off.
+     */
+    external fun setHotwordsNative(streamPtr: Long, hotwords: Array<String>, score: Float)
+
+    /**
+     * Text recognized since the previous call.
+     */
+    external fun getPartialNative(streamPtr: Long): String?
+
+    /**
+     * Recognizes the buffered tail, returns the text of the whole utterance.
+     */
+    external fun finalizeNative(streamPtr: Long): String?
+
+    /**
+     * Speech segments completed since the previous call, as a JSON array of
+     * {"start_ms", "end_ms", "text", "tokens"}.
+     */
+    external fun getSegmentsNative(streamPtr: Long): String?
+
+    /**
+     * Tokens decoded since the previous call, as a JSON array of
+     * {"text", "start_ms", "end_ms", "confidence"}.
+     */
+    external fun getTokensNative(streamPtr: Long): String?
+
+    external fun releaseStreamNative(streamPtr: Long)
+
     interface AsrCallback {
         fun onPartialResult(text: String?)
         fun onFinalResult(text: String?)
+
+        /**
+         * A speech segment found by the VAD and its text, times from the start of the file.
+         */
+        fun onSegment(startMs: Long, endMs: Long, text: String?) {}
     }
 
     init {
@@ -11,6 +11,61 @@ object MNNEmbedding {
 
     external fun embedding(llmPtr: Long, text: String): FloatArray
 
+    /**
+     * Embeds all texts in one native call. The result is a row-major [texts.size, dim] buffer,
+     * or null if any text failed to embed.
+     */
+    external fun embeddingBatch(llmPtr: Long, texts: Array<String>): FloatArray?
+
+    /**
+     * Embeds text and post-processes it natively: keep the first truncateDim dims
+     * (0 keeps all), optionally L2-normalize, then encode with quantization
+     * (see [EmbeddingQuantization]). Layout of one row:
+     * FLOAT32 float[dim]; INT8 float scale + int8[dim]; BINARY ceil(dim / 8) sign bits,
+     * most significant bit first. Floats are little-endian. Null if the text failed to embed.
+     */
+    external fun embeddingEncoded(
+        llmPtr: Long,
+        text: String,
+        truncateDim: Int,
+        normalize: Boolean,
+        quantization: Int
+    ): ByteArray?
+
+    /**
+     * Batch form of [embeddingEncoded], rows of equal size back to back, or null if any text
+     * failed to embed.
+     */
+    external fun embeddingBatchEncoded(
+        llmPtr: Long,
+        texts: Array<String>,
+        truncateDim: Int,
+        normalize: Boolean,
+        quantization: Int
+    ): ByteArray?
+
+    /**
+     * Token count of every text, computed by the tokenizer alone.
+     */
+    external fun countTokens(llmPtr: Long, texts: Array<String>): IntArray
+
+    /**
+     * Tokenizes all texts in parallel. Returns the ids of every text back to back and writes
+     * texts.size + 1 offsets into offsetsOut: the ids of texts[i] are [offsets[i], offsets[i + 1]).
+     */
+    external fun encodeBatch(llmPtr: Long, texts: Array<String>, offsetsOut: IntArray): IntArray
+
+    /**
+     * Splits text into windows of at most maxTokens tokens sharing overlap tokens.
+     * Returns [begin0, end0, begin1, end1, ...] as byte offsets into the UTF-8 encoding of text.
+     */
+    external fun chunkByTokens(llmPtr: Long, text: String, maxTokens: Int, overlap: Int): IntArray
+
+    /**
+     * Embedding cache counters: [hits, misses, persistentHits, entries, bytes].
+     */
+    external fun cacheStatsNative(llmPtr: Long): LongArray
+
     external fun releaseNative(instanceId: Long)
 
     init {
@@ -0,0 +1,20 @@
+package io.kindbrave.mnn.server.engine
+
+object MNNRerank {
+    /**
+     * Returns 0 when the model or its tokenizer can't be loaded.
+     */
+    external fun initNative(configPath: String, configJsonStr: String): Long
+
+    /**
+     * Scores every (query, passage) pair in padded batches, one score per passage in input order,
+     * or null when the forward pass fails.
+     */
+    external fun scoreNative(rerankPtr: Long, query: String, passages: Array<String>): FloatArray?
+
+    external fun releaseNative(rerankPtr: Long)
+
+    init {
+        System.loadLibrary("mnnllmapp")
+    }
+}
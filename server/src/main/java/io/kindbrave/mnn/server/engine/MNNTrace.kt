@@ -0,0 +1,18 @@
+package io.kindbrave.mnn.server.engine
+
+object MNNTrace {
+    /**
+     * Starts or stops recording native spans (tokenize, prefill, decode, fbank, encoder, decoder...).
+     * Enabling also drops previously recorded spans.
+     */
+    external fun setEnabledNative(enabled: Boolean)
+
+    /**
+     * Writes the recorded spans as Chrome trace-event JSON, viewable in ui.perfetto.dev.
+     */
+    external fun dumpNative(outputPath: String): Boolean
+
+    init {
+        System.loadLibrary("mnnllmapp")
+    }
+}
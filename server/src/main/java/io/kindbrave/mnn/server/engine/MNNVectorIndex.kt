@@ -0,0 +1,38 @@
+package io.kindbrave.mnn.server.engine
+
+object MNNVectorIndex {
+    /**
+     * Creates an empty HNSW index. dim = 0 takes the dim of the first inserted vector;
+     * int8 stores vectors quantized to one byte per dim.
+     */
+    external fun createNative(dim: Int, m: Int, efConstruction: Int, efSearch: Int, int8: Boolean): Long
+
+    /**
+     * Loads an index written by saveNative, returns 0 when the file is missing or invalid.
+     */
+    external fun loadNative(path: String): Long
+
+    external fun saveNative(indexPtr: Long, path: String): Boolean
+
+    external fun addNative(indexPtr: Long, id: Long, vector: FloatArray): Boolean
+
+    external fun addTextNative(indexPtr: Long, embeddingPtr: Long, id: Long, text: String): Boolean
+
+    external fun removeNative(indexPtr: Long, id: Long): Boolean
+
+    /**
+     * Returns the ids of the k nearest vectors by cosine similarity, best first.
+     * Their scores are written into scores when it is not null.
+     */
+    external fun searchNative(indexPtr: Long, query: FloatArray, k: Int, scores: FloatArray?): LongArray
+
+    external fun searchTextNative(indexPtr: Long, embeddingPtr: Long, query: String, k: Int, scores: FloatArray?): LongArray?
+
+    external fun sizeNative(indexPtr: Long): Int
+
+    external fun releaseNative(indexPtr: Long)
+
+    init {
+        System.loadLibrary("mnnllmapp")
+    }
+}
@@ -0,0 +1,78 @@
+package io.kindbrave.mnn.server.engine
+
+import android.util.Log
+
+class RerankSession(
+    override val modelId: String,
+    override var sessionId: String,
+    override val configPath: String,
+) : Session(modelId, sessionId, configPath) {
+    private val tag = RerankSession::class.java.simpleName
+
+    private var nativePtr: Long = 0
+
+    @Volatile
+    private var modelLoading = false
+    @Volatile
+    private var generating = false
+    @Volatile
+    private var releaseRequeted = false
+
+    fun load() {
+        modelLoading = true
+        nativePtr = MNNRerank.initNative(configPath, "{}")
+        modelLoading = false
+        if (nativePtr == 0L) {
+            throw Exception("Failed to load rerank model: $configPath")
+        }
+        if (releaseRequeted) {
+            release()
+        }
+    }
+
+    fun score(query: String, passages: List<String>): FloatArray {
+        if (passages.isEmpty()) {
+            return FloatArray(0)
+        }
+        synchronized(this) {
+            generating = true
+            val scores = MNNRerank.scoreNative(nativePtr, query, passages.toTypedArray())
+            generating = false
+            if (releaseRequeted) {
+                release()
+            }
+            return scores ?: throw Exception("Failed to score ${passages.size} passages")
+        }
+    }
+
+    fun release() {
+        synchronized(this) {
+            if (!generating && !modelLoading) {
+                releaseInner()
+            } else {
+                releaseRequeted = true
+                while (generating || modelLoading) {
+                    try {
+                        (this as Object).wait()
+                    } catch (e: InterruptedException) {
+                        Thread.currentThread().interrupt()
+                        Log.e(tag, "Thread interrupted while waiting for release", e)
+                    }
+                }
+                releaseInner()
+            }
+        }
+    }
+
+    private fun releaseInner() {
+        if (nativePtr != 0L) {
+            MNNRerank.releaseNative(nativePtr)
+            nativePtr = 0
+            (this as Object).notifyAll()
+        }
+    }
+
+    protected fun finalize() {
+        release()
+    }
+}
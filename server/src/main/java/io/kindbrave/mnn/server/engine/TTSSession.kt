@@ -108,6 +108,33 @@ class TTSSession(
         }
     }
 
+    /**
+     * Streams 16-bit little-endian PCM to [onChunk], one sentence at a time for BERT-VITS models.
+     * Sherpa models deliver the whole text as a single chunk. For BERT-VITS models [onChunk] runs
+     * under the native TTS lock and must not call back into this session.
+     */
+    fun processStreaming(text: String, id: Int, onChunk: (ByteArray) -> Unit) {
+        when (modelType) {
+            TTSModelType.BERT_VITS -> {
+                val completed = ttsService.processStreaming(text, id) { buffer, byteCount ->
+                    // native order, which is little-endian on every Android ABI
+                    val bytes = ByteArray(byteCount)
+                    buffer.position(0)
+                    buffer.get(bytes, 0, byteCount)
+                    onChunk(bytes)
+                    true
+                }
+                if (!completed) {
+                    throw Exception("Failed to process text: $text")
+                }
+            }
+
+            TTSModelType.SHERPA_VITS,
+            TTSModelType.SHERPA_Kokoro,
+            TTSModelType.SHERPA_Matcha -> onChunk(process(text, id))
+        }
+    }
+
     fun release() {
         ttsService.destroy()
     }
@@ -0,0 +1,62 @@
+package io.kindbrave.mnn.server.engine
+
+class VectorIndex private constructor(private var nativePtr: Long) {
+
+    data class Hit(val id: Long, val score: Float)
+
+    val size: Int
+        get() = MNNVectorIndex.sizeNative(nativePtr)
+
+    fun add(id: Long, vector: FloatArray): Boolean {
+        return MNNVectorIndex.addNative(nativePtr, id, vector)
+    }
+
+    fun add(embedding: EmbeddingSession, id: Long, text: String): Boolean {
+        return MNNVectorIndex.addTextNative(nativePtr, embedding.nativeHandle(), id, text)
+    }
+
+    fun remove(id: Long): Boolean {
+        return MNNVectorIndex.removeNative(nativePtr, id)
+    }
+
+    fun search(query: FloatArray, k: Int): List<Hit> {
+        val scores = FloatArray(k)
+        val ids = MNNVectorIndex.searchNative(nativePtr, query, k, scores)
+        return ids.mapIndexed { i, id -> Hit(id, scores[i]) }
+    }
+
+    fun search(embedding: EmbeddingSession, query: String, k: Int): List<Hit> {
+        val scores = FloatArray(k)
+        val ids = MNNVectorIndex.searchTextNative(nativePtr, embedding.nativeHandle(), query, k, scores)
+            ?: return emptyList()
+        return ids.mapIndexed { i, id -> Hit(id, scores[i]) }
+    }
+
+    fun save(path: String): Boolean {
+        return MNNVectorIndex.saveNative(nativePtr, path)
+    }
+
+    fun release() {
+        synchronized(this) {
+            if (nativePtr != 0L) {
+                MNNVectorIndex.releaseNative(nativePtr)
+                nativePtr = 0
+            }
+        }
+    }
+
+    protected fun finalize() {
+        release()
+    }
+
+    companion object {
+        fun create(dim: Int = 0, m: Int = 16, efConstruction: Int = 200, efSearch: Int = 64, int8: Boolean = false): VectorIndex {
+            return VectorIndex(MNNVectorIndex.createNative(dim, m, efConstruction, efSearch, int8))
+        }
+
+        fun load(path: String): VectorIndex? {
+            val ptr = MNNVectorIndex.loadNative(path)
+            return if (ptr != 0L) VectorIndex(ptr) else null
+        }
+    }
+}
@@ -10,6 +10,8 @@
 #ifndef _HEADER_MNN_TTS_SDK_mnn_tts_SDK_H_
 #define _HEADER_MNN_TTS_SDK_mnn_tts_SDK_H_
 
+#include <functional>
+
 #include "mnn_tts_impl_base.hpp"
 
 #include "chinese_bert.hpp"
@@ -32,10 +34,18 @@ public:
     // 对一个字符串，合成对应的音频
     std::tuple<int, Audio> Process(const std::string& text) override;
 
+    // 逐句合成，每句的generator输出后立即回调，首包延迟为一句而非整段
+    bool ProcessStreaming(const std::string &text, const std::function<bool(const Audio &)> &on_chunk) override;
+
 private:
     // 提取文本对应的音素和bert特征，拿到特征后调用generator来合成音频
     std::tuple<phone_data, std::vector<std::vector<float>>, std::vector<std::vector<float>>> ExtractPhoneTextFeatures(const std::vector<SentLangPair> &word_list_by_lang);
 
+    // 流水线合成：G2P和bert在生产线程上提前处理下一句，当前线程运行generator，每句音频按顺序回调
+    // on_audio返回false时停止，此时返回false
+    bool SynthesizeSentences(const std::vector<std::vector<SentLangPair>> &sentences,
+                             const std::function<bool(int, Audio &)> &on_audio);
+
 private:
     // 资源文件根目录
     std::string resource_root_;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -15,6 +16,14 @@ public:
   // 示例接口方法
   virtual std::tuple<int, Audio> Process(const std::string &text) = 0;
 
+  // 流式合成：每得到一段音频就回调on_chunk，on_chunk返回false时中止合成；全部送出返回true
+  // 默认实现整体合成后回调一次
+  virtual bool ProcessStreaming(const std::string &text, const std::function<bool(const Audio &)> &on_chunk)
+  {
+    auto result = Process(text);
+    return on_chunk(std::get<1>(result));
+  }
+
 private:
   int sample_rate_ = 16000;
 };
\ No newline at end of file
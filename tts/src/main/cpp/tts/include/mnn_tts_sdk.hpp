@@ -17,8 +17,15 @@ public:
 
   // synthesize audio
   std::tuple<int, Audio> Process(const std::string &text);
+  // synthesize sentence by sentence, calling on_chunk with each piece of audio as soon as
+  // it is ready; return false from on_chunk to stop. Returns true when all audio was delivered.
+  bool ProcessStreaming(const std::string &text, const std::function<bool(const Audio &)> &on_chunk);
   void WriteAudioToFile(const Audio &audio_data, const std::string &output_file_path);
 
+  // tracing spans recorded inside the SDK library (g2p, bert, vocoder)
+  static void SetTraceEnabled(bool enabled);
+  static bool DumpTrace(const std::string &output_file_path);
+
 private:
   int sample_rate_;
   std::shared_ptr<MNNTTSImplBase> impl_;
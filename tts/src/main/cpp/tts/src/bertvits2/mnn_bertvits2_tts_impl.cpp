@@ -1,4 +1,74 @@
 #include "mnn_bertvits2_tts_impl.hpp"
+#include "trace/mls_trace.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // 流水线相邻阶段之间的有界队列，生产者最多领先消费者capacity句
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity_(capacity) {}
+
+        // 队列已关闭时返回false
+        bool Push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+            if (closed_)
+            {
+                return false;
+            }
+            items_.push_back(std::move(item));
+            not_empty_.notify_one();
+            return true;
+        }
+
+        // 队列关闭且取空后返回false
+        bool Pop(T &item)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+            if (items_.empty())
+            {
+                return false;
+            }
+            item = std::move(items_.front());
+            items_.pop_front();
+            not_full_.notify_one();
+            return true;
+        }
+
+        void Close()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            not_empty_.notify_all();
+            not_full_.notify_all();
+        }
+
+    private:
+        size_t capacity_;
+        std::deque<T> items_;
+        bool closed_ = false;
+        std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+    };
+
+    struct SentenceFeatures
+    {
+        int index = 0;
+        phone_data g2p;
+        std::vector<std::vector<float>> cn_bert;
+        std::vector<std::vector<float>> en_bert;
+    };
+}
 
 MNNBertVits2TTSImpl::MNNBertVits2TTSImpl(const std::string &local_resource_root, const std::string &tts_generator_model_path, const std::string &mnn_mmap_dir) : cn_g2p_(local_resource_root)
 {
@@ -62,23 +132,22 @@ std::tuple<phone_data, std::vector<std::vector<float>>, std::vector<std::vector<
         std::vector<int> word2ph;
         if (sent_lang.lang == "zh")
         {
+            std::string norm_text;
+            {
+                MLS_TRACE_SCOPE("tts", "g2p");
+                auto [cn_norm_text, g2p_data] = cn_g2p_.Process(sent_lang);
+                norm_text = cn_norm_text;
+                phones = std::get<0>(g2p_data);
+                tones = std::get<1>(g2p_data);
+                lang_ids = std::get<2>(g2p_data);
+                word2ph = std::get<3>(g2p_data);
+            }
 
-            auto t2 = clk::now();
-            auto [norm_text, g2p_data] = cn_g2p_.Process(sent_lang);
-            phones = std::get<0>(g2p_data);
-            tones = std::get<1>(g2p_data);
-            lang_ids = std::get<2>(g2p_data);
-            word2ph = std::get<3>(g2p_data);
-
-            auto t3 = clk::now();
-
-            cn_bert_feat = cn_bert_model_.Process(norm_text, word2ph, "zh");
-            // cn_bert_feat = en_bert_model_.Process(norm_text, word2ph);
-            ed = phones.size();
-            auto t4 = clk::now();
-
-            auto d_g2p = std::chrono::duration_cast<ms>(t3 - t2);
-            auto d_bert = std::chrono::duration_cast<ms>(t4 - t3);
+            {
+                MLS_TRACE_SCOPE("tts", "bert");
+                cn_bert_feat = cn_bert_model_.Process(norm_text, word2ph, "zh");
+                // cn_bert_feat = en_bert_model_.Process(norm_text, word2ph);
+            }
 
             st = 0;
             ed = phones.size();
@@ -119,14 +188,21 @@ std::tuple<phone_data, std::vector<std::vector<float>>, std::vector<std::vector<
         }
         else
         {
-            auto [norm_text, g2p_data] = en_g2p_.Process(sent_lang);
-
-            phones = std::get<0>(g2p_data);
-            tones = std::get<1>(g2p_data);
-            lang_ids = std::get<2>(g2p_data);
-            word2ph = std::get<3>(g2p_data);
+            std::string norm_text;
+            {
+                MLS_TRACE_SCOPE("tts", "g2p");
+                auto [en_norm_text, g2p_data] = en_g2p_.Process(sent_lang);
+                norm_text = en_norm_text;
+                phones = std::get<0>(g2p_data);
+                tones = std::get<1>(g2p_data);
+                lang_ids = std::get<2>(g2p_data);
+                word2ph = std::get<3>(g2p_data);
+            }
 
-            en_bert_feat = en_bert_model_.Process(norm_text, word2ph);
+            {
+                MLS_TRACE_SCOPE("tts", "bert");
+                en_bert_feat = en_bert_model_.Process(norm_text, word2ph);
+            }
             // en_bert_feat = cn_bert_model_.Process(norm_text, word2ph, "en");
 
             st = 0;
@@ -191,14 +267,11 @@ std::tuple<int, Audio> MNNBertVits2TTSImpl::Process(const std::string& in_text)
         PLOG(PDEBUG, "中英文切分后句子" + std::to_string(i) + ": " + ConcatList(sentences[i], "|"));
     }
 
-    for (int i = 0; i < sentences.size(); i++)
-    {
-        auto words_list = sentences[i];
-        PLOG(PDEBUG, "处理句子: " + ConcatList(words_list));
-        auto [g2p_data, cn_bert_feat_data, en_bert_feat_data] = ExtractPhoneTextFeatures(words_list);
-        Audio audio = tts_generator_.Process(g2p_data, cn_bert_feat_data, en_bert_feat_data);
-        audio_list.push_back(audio);
-    }
+    audio_list.resize(sentences.size());
+    SynthesizeSentences(sentences, [&audio_list](int index, Audio &audio)
+                        {
+        audio_list[index] = std::move(audio);
+        return true; });
 
     auto t1 = clk::now();
     auto duration_total = std::chrono::duration_cast<ms>(t1 - t0);
@@ -215,4 +288,127 @@ std::tuple<int, Audio> MNNBertVits2TTSImpl::Process(const std::string& in_text)
     PLOG(INFO, "TTS timecost: " + std::to_string(timecost_in_ms) + "ms, audio_duration: " + std::to_string(audio_len_in_ms) + "ms, rtf:" + std::to_string(rtf));
 
     return std::make_tuple(sample_rate_, audio);
-}
\ No newline at end of file
+}
+
+bool MNNBertVits2TTSImpl::ProcessStreaming(const std::string &in_text, const std::function<bool(const Audio &)> &on_chunk)
+{
+    auto t0 = clk::now();
+
+    PLOG(INFO, "TTS streaming input:" + in_text);
+
+    std::string text(in_text);
+    text = MergeLines(text);
+    auto sentences = text_preprocessor_.Process(text);
+
+    size_t total_samples = 0;
+    bool completed = SynthesizeSentences(sentences, [&](int index, Audio &audio)
+                                         {
+        if (index == 0)
+        {
+            auto first_ms = std::chrono::duration_cast<ms>(clk::now() - t0).count();
+            PLOG(INFO, "TTS first audio: " + std::to_string(first_ms) + "ms");
+        }
+        total_samples += audio.size();
+        return on_chunk(audio); });
+    if (completed)
+    {
+        // 补上与Process相同的尾部静音，使各段拼接后与Process的输出一致
+        size_t padded_samples = PadAudioForAtb(Audio(total_samples, 0), sample_rate_).size();
+        if (padded_samples > total_samples)
+        {
+            completed = on_chunk(Audio(padded_samples - total_samples, 0));
+            total_samples = padded_samples;
+        }
+    }
+
+    auto duration_total = std::chrono::duration_cast<ms>(clk::now() - t0);
+    float audio_len_in_ms = float(total_samples * 1000) / float(sample_rate_);
+    float timecost_in_ms = (float)duration_total.count();
+    PLOG(INFO, "TTS streaming timecost: " + std::to_string(timecost_in_ms) + "ms, audio_duration: " + std::to_string(audio_len_in_ms) + "ms, rtf:" + std::to_string(timecost_in_ms / audio_len_in_ms));
+
+    return completed;
+}
+
+bool MNNBertVits2TTSImpl::SynthesizeSentences(const std::vector<std::vector<SentLangPair>> &sentences,
+                                              const std::function<bool(int, Audio &)> &on_audio)
+{
+    // 前端（G2P + bert，单线程）和generator（4线程）使用各自的executor，可以在两个线程上并行
+    BoundedQueue<SentenceFeatures> queue(2);
+    std::exception_ptr producer_error;
+    long long frontend_ms = 0;
+    std::thread producer([&]()
+                         {
+        try
+        {
+            for (int i = 0; i < sentences.size(); i++)
+            {
+                PLOG(PDEBUG, "处理句子: " + ConcatList(sentences[i]));
+                auto t0 = clk::now();
+                SentenceFeatures features;
+                features.index = i;
+                std::tie(features.g2p, features.cn_bert, features.en_bert) = ExtractPhoneTextFeatures(sentences[i]);
+                frontend_ms += std::chrono::duration_cast<ms>(clk::now() - t0).count();
+                if (!queue.Push(std::move(features)))
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            producer_error = std::current_exception();
+        }
+        queue.Close(); });
+
+    long long vocoder_ms = 0;
+    long long wait_ms = 0;
+    bool completed = true;
+    std::exception_ptr consumer_error;
+    try
+    {
+        SentenceFeatures features;
+        while (true)
+        {
+            auto t0 = clk::now();
+            if (!queue.Pop(features))
+            {
+                break;
+            }
+            auto t1 = clk::now();
+            Audio audio;
+            {
+                MLS_TRACE_SCOPE("tts", "vocoder");
+                audio = tts_generator_.Process(features.g2p, features.cn_bert, features.en_bert);
+            }
+            auto t2 = clk::now();
+            wait_ms += std::chrono::duration_cast<ms>(t1 - t0).count();
+            vocoder_ms += std::chrono::duration_cast<ms>(t2 - t1).count();
+            if (!on_audio(features.index, audio))
+            {
+                completed = false;
+                break;
+            }
+        }
+    }
+    catch (...)
+    {
+        consumer_error = std::current_exception();
+    }
+    // 消费端提前退出时关闭队列，让生产者不再阻塞
+    queue.Close();
+    producer.join();
+    if (consumer_error)
+    {
+        std::rethrow_exception(consumer_error);
+    }
+    if (producer_error)
+    {
+        std::rethrow_exception(producer_error);
+    }
+
+    // 流水线收益的测量方法：frontend为前端总耗时F，vocoder为generator总耗时V，vocoder waiting为generator等待前端的时间W。
+    // 串行时总耗时约为F + V，流水线后约为V + W（W约等于第一句的前端耗时加上后续的停顿），节省比例为(F - W) / (F + V)。
+    // 端到端效果看上面的TTS timecost rtf日志，用同一段多句文本对比流水线前后的版本
+    PLOG(INFO, "TTS pipeline sentences: " + std::to_string(sentences.size()) + ", frontend: " + std::to_string(frontend_ms) + "ms, vocoder: " + std::to_string(vocoder_ms) + "ms, vocoder waiting: " + std::to_string(wait_ms) + "ms");
+    return completed;
+}
@@ -1,6 +1,7 @@
 
 #include "mnn_tts_sdk.hpp"
 #include "piper/utf8.h"
+#include "trace/mls_trace.hpp"
 #include <mutex>
 #include <codecvt> // For std::wstring_convert and std::codecvt_utf8
 #include <locale>
@@ -35,6 +36,11 @@ std::tuple<int, Audio> MNNTTSSDK::Process(const std::string &text)
   return impl_->Process(text);
 }
 
+bool MNNTTSSDK::ProcessStreaming(const std::string &text, const std::function<bool(const Audio &)> &on_chunk)
+{
+  return impl_->ProcessStreaming(text, on_chunk);
+}
+
 void MNNTTSSDK::WriteAudioToFile(const Audio &audio_data, const std::string &output_file_path)
 {
   std::ofstream audioFile(output_file_path, std::ios::binary);
@@ -45,3 +51,17 @@ void MNNTTSSDK::WriteAudioToFile(const Audio &audio_data, const std::string &out
   audioFile.write((const char *)audio_data.data(),
                   sizeof(int16_t) * audio_data.size());
 }
+
+void MNNTTSSDK::SetTraceEnabled(bool enabled)
+{
+  if (enabled)
+  {
+    mls::trace::clear();
+  }
+  mls::trace::set_enabled(enabled);
+}
+
+bool MNNTTSSDK::DumpTrace(const std::string &output_file_path)
+{
+  return mls::trace::export_chrome_json(output_file_path);
+}
@@ -56,6 +56,15 @@ std::vector<int16_t> TTSService::Process(const std::string &text, int id) {
     return {};
 }
 
+bool TTSService::ProcessStreaming(const std::string &text, int id,
+                                  const std::function<bool(const std::vector<int16_t> &)> &on_chunk) {
+    if (tts_ == nullptr || text.empty()) {
+        MH_ERROR("Failed to process text to speech.");
+        return false;
+    }
+    return tts_->ProcessStreaming(text, on_chunk);
+}
+
 TTSService::TTSService(std::string language):language_(std::move(language)) {
 
 }
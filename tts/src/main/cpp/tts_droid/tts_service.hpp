@@ -12,6 +12,10 @@ public:
     explicit TTSService(std::string language);
     bool LoadTtsResources(const char *resPath, const char* modelName, const char* cacheDir);
     std::vector<int16_t> Process(const std::string &text, int id);
+    // Streams the audio of each sentence to on_chunk as it is synthesized. Returns false when
+    // on_chunk stopped the stream or nothing could be synthesized.
+    bool ProcessStreaming(const std::string &text, int id,
+                          const std::function<bool(const std::vector<int16_t> &)> &on_chunk);
     void SetIndex(int index);
     virtual ~TTSService();
 private:
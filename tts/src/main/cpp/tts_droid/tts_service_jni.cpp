@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <functional>
 #include "tts_service.hpp"
@@ -6,6 +8,18 @@
 static TaoAvatar::TTSService *gTTSService = nullptr;
 std::mutex gTTSMutex;
 
+// Raises a Java RuntimeException, unless a callback already left one pending.
+static void ThrowRuntimeException(JNIEnv *env, const char *message) {
+    if (env->ExceptionCheck()) {
+        return;
+    }
+    jclass exceptionClass = env->FindClass("java/lang/RuntimeException");
+    if (exceptionClass != nullptr) {
+        env->ThrowNew(exceptionClass, message);
+        env->DeleteLocalRef(exceptionClass);
+    }
+}
+
 extern "C" {
 
 JNIEXPORT jlong JNICALL
@@ -53,7 +67,14 @@ Java_com_taobao_meta_avatar_tts_TtsService_nativeProcess(JNIEnv *env, jobject th
     std::unique_lock<std::mutex> lock(gTTSMutex);
     auto ttsService = reinterpret_cast<TaoAvatar::TTSService *>(nativePtr);
     const char *textCStr = env->GetStringUTFChars(text, nullptr);
-    std::vector<int16_t> samples = ttsService->Process(textCStr, id);
+    std::vector<int16_t> samples;
+    try {
+        samples = ttsService->Process(textCStr, id);
+    } catch (const std::exception &e) {
+        env->ReleaseStringUTFChars(text, textCStr);
+        ThrowRuntimeException(env, e.what());
+        return nullptr;
+    }
     jshortArray samplesArray = env->NewShortArray(samples.size());
     if (samplesArray != nullptr) {
         env->SetShortArrayRegion(samplesArray, 0, samples.size(),samples.data());
@@ -62,6 +83,66 @@ Java_com_taobao_meta_avatar_tts_TtsService_nativeProcess(JNIEnv *env, jobject th
     return samplesArray;
 }
 
+// Streams each sentence's samples through the caller's direct buffer: the buffer is
+// refilled for every callback, chunks larger than it are split across several calls.
+// gTTSMutex stays held across the Java callbacks: releasing it would let nativeDestroy free
+// the service mid-synthesis. Callbacks must therefore not re-enter TtsService.
+JNIEXPORT jboolean JNICALL
+Java_com_taobao_meta_avatar_tts_TtsService_nativeProcessStreaming(JNIEnv *env, jobject thiz,
+                                                                  jlong nativePtr, jstring text,
+                                                                  jint id, jobject buffer,
+                                                                  jobject callback) {
+    std::unique_lock<std::mutex> lock(gTTSMutex);
+    auto ttsService = reinterpret_cast<TaoAvatar::TTSService *>(nativePtr);
+    auto *dst = static_cast<int16_t *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer) / static_cast<jlong>(sizeof(int16_t));
+    if (!ttsService || dst == nullptr || capacity <= 0) {
+        return JNI_FALSE;
+    }
+    jclass callbackClass = env->GetObjectClass(callback);
+    jmethodID onChunk = env->GetMethodID(callbackClass, "onChunk", "(Ljava/nio/ByteBuffer;I)Z");
+    env->DeleteLocalRef(callbackClass);
+    if (onChunk == nullptr) {
+        return JNI_FALSE;
+    }
+    const char *textCStr = env->GetStringUTFChars(text, nullptr);
+    bool result = false;
+    // exceptions from G2P/BERT/the generator must not cross into the JVM
+    try {
+        result = ttsService->ProcessStreaming(textCStr, id, [&](const std::vector<int16_t> &samples) {
+            for (size_t offset = 0; offset < samples.size(); offset += capacity) {
+                size_t count = std::min<size_t>(capacity, samples.size() - offset);
+                memcpy(dst, samples.data() + offset, count * sizeof(int16_t));
+                jboolean keep = env->CallBooleanMethod(callback, onChunk, buffer,
+                                                       static_cast<jint>(count * sizeof(int16_t)));
+                if (env->ExceptionCheck() || keep == JNI_FALSE) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    } catch (const std::exception &e) {
+        env->ReleaseStringUTFChars(text, textCStr);
+        ThrowRuntimeException(env, e.what());
+        return JNI_FALSE;
+    }
+    env->ReleaseStringUTFChars(text, textCStr);
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_taobao_meta_avatar_tts_TtsService_nativeSetTraceEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
+    MNNTTSSDK::SetTraceEnabled(enabled == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_taobao_meta_avatar_tts_TtsService_nativeDumpTrace(JNIEnv *env, jobject thiz, jstring outputPath) {
+    const char *outputPathCStr = env->GetStringUTFChars(outputPath, nullptr);
+    bool result = MNNTTSSDK::DumpTrace(outputPathCStr);
+    env->ReleaseStringUTFChars(outputPath, outputPathCStr);
+    return result ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT void JNICALL
 Java_com_taobao_meta_avatar_tts_TtsService_nativeSetCurrentIndex(JNIEnv *env, jobject thiz,
                                                                  jlong tts_service_native,
@@ -5,6 +5,16 @@ import kotlinx.coroutines.CoroutineScope
 import kotlinx.coroutines.Deferred
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.async
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Receives streamed 16-bit PCM. [buffer] holds [byteCount] bytes from position 0 in native byte
+ * order and is overwritten by the next chunk. Return false to stop synthesis.
+ */
+fun interface AudioChunkCallback {
+    fun onChunk(buffer: ByteBuffer, byteCount: Int): Boolean
+}
 
 class TtsService {
 
@@ -16,6 +26,10 @@ class TtsService {
     @Volatile
     private var isLoaded = false
     private var initDeferred: Deferred<Boolean>? = null
+    // reused by every processStreaming call, native code fills it for each chunk
+    private val chunkBuffer: ByteBuffer by lazy {
+        ByteBuffer.allocateDirect(CHUNK_BUFFER_BYTES).order(ByteOrder.nativeOrder())
+    }
 
     init {
         ttsServiceNative = nativeCreateTTS(if (AppUtils.isChinese())  "zh" else "en")
@@ -65,6 +79,26 @@ class TtsService {
         return nativeProcess(ttsServiceNative, text, id)
     }
 
+    /**
+     * Synthesizes text sentence by sentence, handing each sentence's audio to [callback] as soon
+     * as it is generated instead of after the whole text.
+     *
+     * [callback] runs on the calling thread while the native TTS lock is held, so it must not call
+     * back into any TtsService ([process], [processStreaming], [destroy], ...): that deadlocks.
+     * Hand the audio to another thread if it needs to start more synthesis.
+     */
+    fun processStreaming(text: String, id: Int, callback: AudioChunkCallback): Boolean {
+        return nativeProcessStreaming(ttsServiceNative, text, id, chunkBuffer, callback)
+    }
+
+    fun setTraceEnabled(enabled: Boolean) {
+        nativeSetTraceEnabled(enabled)
+    }
+
+    fun dumpTrace(outputPath: String): Boolean {
+        return nativeDumpTrace(outputPath)
+    }
+
 //    fun processSherpa(text: String, id: Int): GeneratedAudio? {
 //        Log.d(TAG, "processSherpa: $text $id")
 //        synchronized(this) {
@@ -81,9 +115,18 @@ class TtsService {
                                                      modelName:String,
                                                      mmapDir:String): Boolean
     private external fun nativeProcess(nativePtr: Long, text: String, id: Int): ShortArray
+    private external fun nativeProcessStreaming(nativePtr: Long,
+                                                text: String,
+                                                id: Int,
+                                                buffer: ByteBuffer,
+                                                callback: AudioChunkCallback): Boolean
+    private external fun nativeSetTraceEnabled(enabled: Boolean)
+    private external fun nativeDumpTrace(outputPath: String): Boolean
 
     companion object {
         private const val TAG = "TtsService"
+        // one second of 16-bit audio at 44.1 kHz, rounded up
+        private const val CHUNK_BUFFER_BYTES = 128 * 1024
 
         init {
             System.loadLibrary("taoavatar")
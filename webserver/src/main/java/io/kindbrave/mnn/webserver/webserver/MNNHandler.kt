@@ -296,24 +296,14 @@ class MNNHandler @Inject constructor(
             throw InvalidParameterException("Audio is null")
         }
 
-        val generateResponse = StringBuilder()
-        asrSession.generate(audioPath, object : MNNAsr.AsrCallback {
-            override fun onPartialResult(text: String?) {
-
-            }
-
-            override fun onFinalResult(text: String?) {
-                generateResponse.append(text)
-            }
-
-        })
+        val generateResponse = asrSession.recognize(audioPath)
         val promptLen = 0L
         val decodeLen = 0L
         val response = MNNHandlerUtils.buildChatCompletionResponse(
             id = "chatcmpl-$messageId",
             created = createdTime,
             model = modelId,
-            content = generateResponse.toString(),
+            content = generateResponse,
             promptTokens = promptLen,
             completionTokens = decodeLen
         )
@@ -335,15 +325,20 @@ class MNNHandler @Inject constructor(
         modelId: String,
         embeddingSession: EmbeddingSession
     ): JSONObject {
-        val embedding = embeddingSession.embedding(input.getString(0))
-        val result = JSONObject()
-            .put("object", "list")
-            .put("data", JSONArray().put(
+        val texts = List(input.length()) { input.getString(it) }
+        val embeddings = embeddingSession.embeddingBatch(texts)
+        val data = JSONArray()
+        embeddings.forEachIndexed { index, embedding ->
+            data.put(
                 JSONObject()
                     .put("object", "embedding")
                     .put("embedding", JSONArray(embedding))
-                    .put("index", 0)
-            ))
+                    .put("index", index)
+            )
+        }
+        val result = JSONObject()
+            .put("object", "list")
+            .put("data", data)
             .put("model", modelId)
         return result
     }